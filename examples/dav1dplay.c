@@ -28,6 +28,7 @@
 #include "vcs_version.h"
 
 #include <getopt.h>
+#include <math.h>
 #include <stdbool.h>
 
 #include <SDL.h>
@@ -99,6 +100,27 @@ typedef struct render_context
     uint8_t dec_should_terminate;
 } Dav1dPlayRenderContext;
 
+/**
+ * Presentation statistics, collected with --benchmark
+ */
+typedef struct pacing_stats
+{
+    // Time when the last frame was presented (in ns), 0 after a discontinuity
+    uint64_t last_time;
+    // Timestamp of the last presented frame (in timebase unit)
+    int64_t last_ts;
+    uint32_t n_frames;
+    // Deviation of the presentation intervals from the timestamp intervals
+    uint32_t n_intervals;
+    double sum_err, sum_err_sq, max_err; // in ms
+    // Frame slots that passed while presenting late, i.e. the frames a
+    // player keeping sync would have dropped
+    uint32_t n_dropped;
+    // Number of decoded frames queued when a frame is presented
+    uint64_t sum_depth;
+    size_t min_depth, max_depth;
+} Dav1dPlayPacingStats;
+
 static void dp_settings_print_usage(const char *const app,
                                     const char *const reason, ...)
 {
@@ -120,6 +142,8 @@ static void dp_settings_print_usage(const char *const app,
             " --highquality:        enable high quality rendering\n"
             " --zerocopy/-z:        enable zero copy upload path\n"
             " --gpugrain/-g:        enable GPU grain synthesis\n"
+            " --benchmark:          play headless (SDL dummy video driver, software rendering) and\n"
+            "                       report presentation jitter, queue depth and dropped frames\n"
             " --version/-v:         print version and exit\n"
             " --renderer/-r:        select renderer backend (default: auto)\n");
     exit(1);
@@ -150,6 +174,7 @@ static void dp_rd_ctx_parse_args(Dav1dPlayRenderContext *rd_ctx,
         ARG_THREADS = 256,
         ARG_FRAME_DELAY,
         ARG_HIGH_QUALITY,
+        ARG_BENCHMARK,
     };
 
     // Long options
@@ -163,6 +188,7 @@ static void dp_rd_ctx_parse_args(Dav1dPlayRenderContext *rd_ctx,
         { "zerocopy",       0, NULL, 'z' },
         { "gpugrain",       0, NULL, 'g' },
         { "renderer",       0, NULL, 'r'},
+        { "benchmark",      0, NULL, ARG_BENCHMARK },
         { NULL,             0, NULL, 0 },
     };
 
@@ -180,6 +206,9 @@ static void dp_rd_ctx_parse_args(Dav1dPlayRenderContext *rd_ctx,
             case ARG_HIGH_QUALITY:
                 settings->highquality = true;
                 break;
+            case ARG_BENCHMARK:
+                settings->benchmark = true;
+                break;
             case 'z':
                 settings->zerocopy = true;
                 break;
@@ -209,6 +238,8 @@ static void dp_rd_ctx_parse_args(Dav1dPlayRenderContext *rd_ctx,
         dp_settings_print_usage(argv[0], "Input file (-i/--input) is required");
     if (settings->renderer_name && strcmp(settings->renderer_name, "auto") == 0)
         settings->renderer_name = NULL;
+    if (settings->benchmark && !settings->renderer_name)
+        settings->renderer_name = "sdl";
 }
 
 /**
@@ -240,6 +271,25 @@ static Dav1dPlayRenderContext *dp_rd_ctx_create(int argc, char **argv)
         return NULL;
     }
 
+    // Parse and validate arguments
+    dav1d_default_settings(&rd_ctx->lib_settings);
+    memset(&rd_ctx->settings, 0, sizeof(rd_ctx->settings));
+    dp_rd_ctx_parse_args(rd_ctx, argc, argv);
+
+    if (rd_ctx->settings.benchmark) {
+        // No display needed, unless a video driver is requested explicitly;
+        // the dummy driver only supports software rendering
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    }
+
+    // Init SDL2 library
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+        free(rd_ctx);
+        return NULL;
+    }
+
     // Register a custom event to notify our SDL main thread
     // about new frames
     rd_ctx->event_types = SDL_RegisterEvents(3);
@@ -264,11 +314,6 @@ static Dav1dPlayRenderContext *dp_rd_ctx_create(int argc, char **argv)
         return NULL;
     }
 
-    // Parse and validate arguments
-    dav1d_default_settings(&rd_ctx->lib_settings);
-    memset(&rd_ctx->settings, 0, sizeof(rd_ctx->settings));
-    dp_rd_ctx_parse_args(rd_ctx, argc, argv);
-
     // Select renderer
     renderer_info = dp_get_renderer(rd_ctx->settings.renderer_name);
 
@@ -415,8 +460,9 @@ static int dp_rd_ctx_handle_seek(Dav1dPlayRenderContext *rd_ctx,
                 pts = TS_TO_PTS(p->m.timestamp);
                 if (pts < target_pts)
                     destroy_pic(p);
+                else if (dp_fifo_push(rd_ctx->fifo, p))
+                    destroy_pic(p);
                 else {
-                    dp_fifo_push(rd_ctx->fifo, p);
                     uint32_t type = rd_ctx->event_types + DAV1D_EVENT_SEEK_FRAME;
                     dp_rd_ctx_post_event(rd_ctx, type);
                 }
@@ -442,6 +488,64 @@ out:
     return res;
 }
 
+static uint64_t dp_get_time_nanos(void)
+{
+    return (uint64_t)((double)SDL_GetPerformanceCounter() * 1000000000.0 /
+                      SDL_GetPerformanceFrequency());
+}
+
+/**
+ * Account a presented frame in the pacing statistics
+ */
+static void dp_pacing_update(Dav1dPlayPacingStats *stats,
+                             Dav1dPlayRenderContext *rd_ctx,
+                             int64_t ts, size_t depth)
+{
+    const uint64_t now = dp_get_time_nanos();
+
+    if (!stats->n_frames++ || depth < stats->min_depth)
+        stats->min_depth = depth;
+    if (depth > stats->max_depth)
+        stats->max_depth = depth;
+    stats->sum_depth += depth;
+
+    if (stats->last_time && !rd_ctx->settings.untimed) {
+        SDL_LockMutex(rd_ctx->lock);
+        const double interval = (now - stats->last_time) / 1000000.0;
+        const double expected = (ts - stats->last_ts) * rd_ctx->timebase * 1000.0;
+        const double frame_duration = rd_ctx->spf * 1000.0;
+        SDL_UnlockMutex(rd_ctx->lock);
+
+        const double err = interval - expected;
+        stats->n_intervals++;
+        stats->sum_err += err;
+        stats->sum_err_sq += err * err;
+        if (fabs(err) > stats->max_err)
+            stats->max_err = fabs(err);
+        if (err > 0 && frame_duration > 0)
+            stats->n_dropped += (uint32_t)(err / frame_duration);
+    }
+    stats->last_time = now;
+    stats->last_ts = ts;
+}
+
+static void dp_pacing_print(const Dav1dPlayPacingStats *stats)
+{
+    if (!stats->n_frames)
+        return;
+    printf("Queue depth: avg %.2f, min %zu, max %zu frames\n",
+           (double)stats->sum_depth / stats->n_frames,
+           stats->min_depth, stats->max_depth);
+    if (!stats->n_intervals)
+        return;
+    const double mean = stats->sum_err / stats->n_intervals;
+    const double var = stats->sum_err_sq / stats->n_intervals - mean * mean;
+    printf("Presentation interval error: avg %.3f ms, jitter %.3f ms, max %.3f ms\n",
+           mean, var > 0 ? sqrt(var) : 0.0, stats->max_err);
+    printf("Dropped frames: %u (frame slots missed by late presentation)\n",
+           stats->n_dropped);
+}
+
 /**
  * Terminate decoder thread (async)
  */
@@ -598,9 +702,13 @@ static int decoder_thread_main(void *cookie)
             int seek = rd_ctx->seek;
             SDL_UnlockMutex(rd_ctx->lock);
             if (!seek) {
-                dp_fifo_push(rd_ctx->fifo, p);
-                uint32_t type = rd_ctx->event_types + DAV1D_EVENT_NEW_FRAME;
-                dp_rd_ctx_post_event(rd_ctx, type);
+                // a frame pushed while the FIFO was flushed is stale
+                if (dp_fifo_push(rd_ctx->fifo, p)) {
+                    destroy_pic(p);
+                } else {
+                    uint32_t type = rd_ctx->event_types + DAV1D_EVENT_NEW_FRAME;
+                    dp_rd_ctx_post_event(rd_ctx, type);
+                }
             }
         }
     }
@@ -633,9 +741,12 @@ static int decoder_thread_main(void *cookie)
             }
         } else {
             // Queue frame
-            dp_fifo_push(rd_ctx->fifo, p);
-            uint32_t type = rd_ctx->event_types + DAV1D_EVENT_NEW_FRAME;
-            dp_rd_ctx_post_event(rd_ctx, type);
+            if (dp_fifo_push(rd_ctx->fifo, p)) {
+                destroy_pic(p);
+            } else {
+                uint32_t type = rd_ctx->event_types + DAV1D_EVENT_NEW_FRAME;
+                dp_rd_ctx_post_event(rd_ctx, type);
+            }
         }
     } while (res != DAV1D_ERR(EAGAIN));
 
@@ -662,10 +773,6 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    // Init SDL2 library
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0)
-        return 10;
-
     // Create render context
     Dav1dPlayRenderContext *rd_ctx = dp_rd_ctx_create(argc, argv);
     if (rd_ctx == NULL) {
@@ -701,6 +808,7 @@ int main(int argc, char **argv)
     SDL_Event events[NUM_MAX_EVENTS];
     int num_frame_events = 0;
     uint32_t start_time = 0, n_out = 0;
+    Dav1dPlayPacingStats pacing = { 0 };
     while (1) {
         int num_events = 0;
         SDL_WaitEvent(NULL);
@@ -724,6 +832,7 @@ int main(int argc, char **argv)
                 SDL_KeyboardEvent *kbde = (SDL_KeyboardEvent *)e;
                 if (kbde->keysym.sym == SDLK_SPACE) {
                     dp_rd_ctx_toggle_pause(rd_ctx);
+                    pacing.last_time = 0;
                 } else if (kbde->keysym.sym == SDLK_LEFT ||
                            kbde->keysym.sym == SDLK_RIGHT)
                 {
@@ -749,17 +858,22 @@ int main(int argc, char **argv)
                     n_out++;
                 }
                 destroy_pic(p);
+                pacing.last_time = 0;
             } else if (e->type == rd_ctx->event_types + DAV1D_EVENT_DEC_QUIT) {
                 goto out;
             }
         }
         if (num_frame_events && !dp_rd_ctx_is_paused(rd_ctx)) {
             // Dequeue frame and update the render context with it
+            const size_t depth = dp_fifo_count(rd_ctx->fifo);
             Dav1dPicture *p = dp_fifo_shift(rd_ctx->fifo);
             // Do not update textures during termination
             if (!dp_rd_ctx_should_terminate(rd_ctx)) {
+                const int64_t ts = p->m.timestamp;
                 dp_rd_ctx_update_with_dav1d_picture(rd_ctx, p);
                 dp_rd_ctx_render(rd_ctx);
+                if (rd_ctx->settings.benchmark)
+                    dp_pacing_update(&pacing, rd_ctx, ts, depth);
                 n_out++;
             }
             destroy_pic(p);
@@ -772,6 +886,8 @@ out:;
     uint32_t time_ms = SDL_GetTicks() - start_time - rd_ctx->pause_time;
     printf("Decoded %u frames in %d seconds, avg %.02f fps\n",
            n_out, time_ms / 1000, n_out/ (time_ms / 1000.0));
+    if (rd_ctx->settings.benchmark)
+        dp_pacing_print(&pacing);
 
     int decoder_ret = 0;
     SDL_WaitThread(decoder_thread, &decoder_ret);
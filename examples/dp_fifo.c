@@ -24,21 +24,32 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+
 #include <SDL.h>
 #include <assert.h>
 
 #include "dp_fifo.h"
 
 // FIFO structure
+//
+// Lock-free ring for exactly one producer (the decoder thread) and one
+// consumer (the renderer): head is only advanced by the consumer, tail only
+// by the producer, both modulo 2 * capacity so that a full FIFO can be told
+// apart from an empty one. The semaphores are only used to sleep while the
+// FIFO is full or empty; a wakeup may be spurious, so waiters always re-check.
+// flush_gen is bumped by every flush, so that a push which was blocked while
+// the FIFO was flushed drops its (now stale) element instead of queuing it.
 struct dp_fifo
 {
-    SDL_mutex *lock;
-    SDL_cond *cond_change;
     size_t capacity;
-    size_t count;
     void **entries;
-    int push_wait;
-    int flush;
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    SDL_atomic_t push_wait;
+    SDL_atomic_t shift_wait;
+    SDL_atomic_t flush_gen;
+    SDL_sem *space;
+    SDL_sem *avail;
 };
 
 
@@ -50,29 +61,16 @@ Dav1dPlayPtrFifo *dp_fifo_create(size_t capacity)
     if (capacity <= 0)
         return NULL;
 
-    fifo = malloc(sizeof(*fifo));
+    fifo = calloc(1, sizeof(*fifo));
     if (fifo == NULL)
         return NULL;
 
     fifo->capacity = capacity;
-    fifo->count = 0;
-    fifo->push_wait = 0;
-    fifo->flush = 0;
-
-    fifo->lock = SDL_CreateMutex();
-    if (fifo->lock == NULL) {
-        free(fifo);
-        return NULL;
-    }
-    fifo->cond_change = SDL_CreateCond();
-    if (fifo->cond_change == NULL) {
-        SDL_DestroyMutex(fifo->lock);
-        free(fifo);
-        return NULL;
-    }
 
+    fifo->space = SDL_CreateSemaphore(0);
+    fifo->avail = SDL_CreateSemaphore(0);
     fifo->entries = calloc(capacity, sizeof(void*));
-    if (fifo->entries == NULL) {
+    if (fifo->space == NULL || fifo->avail == NULL || fifo->entries == NULL) {
         dp_fifo_destroy(fifo);
         return NULL;
     }
@@ -83,65 +81,73 @@ Dav1dPlayPtrFifo *dp_fifo_create(size_t capacity)
 // Destroy FIFO
 void dp_fifo_destroy(Dav1dPlayPtrFifo *fifo)
 {
-    assert(fifo->count == 0);
-    SDL_DestroyMutex(fifo->lock);
-    SDL_DestroyCond(fifo->cond_change);
+    assert(dp_fifo_count(fifo) == 0);
+    if (fifo->space)
+        SDL_DestroySemaphore(fifo->space);
+    if (fifo->avail)
+        SDL_DestroySemaphore(fifo->avail);
     free(fifo->entries);
     free(fifo);
 }
 
-// Push to FIFO
-void dp_fifo_push(Dav1dPlayPtrFifo *fifo, void *element)
+static size_t dp_fifo_distance(const Dav1dPlayPtrFifo *fifo,
+                               size_t head, size_t tail)
 {
-    SDL_LockMutex(fifo->lock);
-    while (fifo->count == fifo->capacity) {
-        fifo->push_wait = 1;
-        SDL_CondWait(fifo->cond_change, fifo->lock);
-        fifo->push_wait = 0;
-        if (fifo->flush) {
-            SDL_CondSignal(fifo->cond_change);
-            SDL_UnlockMutex(fifo->lock);
-            return;
-        }
-    }
-    fifo->entries[fifo->count++] = element;
-    if (fifo->count == 1)
-        SDL_CondSignal(fifo->cond_change);
-    SDL_UnlockMutex(fifo->lock);
+    return (tail + 2 * fifo->capacity - head) % (2 * fifo->capacity);
 }
 
-// Helper that shifts the FIFO array
-static void *dp_fifo_array_shift(void **arr, size_t len)
+size_t dp_fifo_count(Dav1dPlayPtrFifo *fifo)
 {
-    void *shifted_element = arr[0];
-    for (size_t i = 1; i < len; ++i)
-        arr[i-1] = arr[i];
-    return shifted_element;
+    return dp_fifo_distance(fifo, SDL_AtomicGet(&fifo->head),
+                            SDL_AtomicGet(&fifo->tail));
+}
+
+// Push to FIFO
+int dp_fifo_push(Dav1dPlayPtrFifo *fifo, void *element)
+{
+    const size_t tail = SDL_AtomicGet(&fifo->tail);
+    const int gen = SDL_AtomicGet(&fifo->flush_gen);
+    while (dp_fifo_distance(fifo, SDL_AtomicGet(&fifo->head), tail) == fifo->capacity) {
+        // announce the wait before re-checking, so that the consumer either
+        // sees the flag or we see its update of head
+        SDL_AtomicSet(&fifo->push_wait, 1);
+        if (dp_fifo_distance(fifo, SDL_AtomicGet(&fifo->head), tail) == fifo->capacity)
+            SDL_SemWait(fifo->space);
+        SDL_AtomicSet(&fifo->push_wait, 0);
+        // the FIFO was flushed while we waited, drop the element
+        if (SDL_AtomicGet(&fifo->flush_gen) != gen)
+            return -1;
+    }
+    fifo->entries[tail % fifo->capacity] = element;
+    // SDL_AtomicSet() is a full barrier, publishing the entry
+    SDL_AtomicSet(&fifo->tail, (int) ((tail + 1) % (2 * fifo->capacity)));
+    if (SDL_AtomicGet(&fifo->shift_wait))
+        SDL_SemPost(fifo->avail);
+    return 0;
 }
 
 // Get item from FIFO
 void *dp_fifo_shift(Dav1dPlayPtrFifo *fifo)
 {
-    SDL_LockMutex(fifo->lock);
-    while (fifo->count == 0)
-        SDL_CondWait(fifo->cond_change, fifo->lock);
-    void *res = dp_fifo_array_shift(fifo->entries, fifo->count--);
-    if (fifo->count == fifo->capacity - 1)
-        SDL_CondSignal(fifo->cond_change);
-    SDL_UnlockMutex(fifo->lock);
+    const size_t head = SDL_AtomicGet(&fifo->head);
+    while ((size_t) SDL_AtomicGet(&fifo->tail) == head) {
+        SDL_AtomicSet(&fifo->shift_wait, 1);
+        if ((size_t) SDL_AtomicGet(&fifo->tail) == head)
+            SDL_SemWait(fifo->avail);
+        SDL_AtomicSet(&fifo->shift_wait, 0);
+    }
+    void *res = fifo->entries[head % fifo->capacity];
+    SDL_AtomicSet(&fifo->head, (int) ((head + 1) % (2 * fifo->capacity)));
+    if (SDL_AtomicGet(&fifo->push_wait))
+        SDL_SemPost(fifo->space);
     return res;
 }
 
 void dp_fifo_flush(Dav1dPlayPtrFifo *fifo, void (*destroy_elem)(void *))
 {
-    SDL_LockMutex(fifo->lock);
-    fifo->flush = 1;
-    if (fifo->push_wait) {
-        SDL_CondSignal(fifo->cond_change);
-        SDL_CondWait(fifo->cond_change, fifo->lock);
-    }
-    while (fifo->count)
-        destroy_elem(fifo->entries[--fifo->count]);
-    fifo->flush = 0;
-    SDL_UnlockMutex(fifo->lock);
+    // bump the generation before making room, so that a push blocked on
+    // the full FIFO sees it once woken up and drops its element
+    SDL_AtomicIncRef(&fifo->flush_gen);
+    while (dp_fifo_count(fifo))
+        destroy_elem(dp_fifo_shift(fifo));
 }
@@ -35,6 +35,8 @@ typedef struct dp_fifo Dav1dPlayPtrFifo;
  * Creates a FIFO with the given capacity.
  * If the capacity is reached, new inserts into the FIFO
  * will block until enough space is available again.
+ * The FIFO is lock-free, but only supports a single thread
+ * pushing and a single (other) thread shifting or flushing.
  */
 Dav1dPlayPtrFifo *dp_fifo_create(size_t capacity);
 
@@ -57,7 +59,22 @@ void *dp_fifo_shift(Dav1dPlayPtrFifo *fifo);
  * If the FIFO is full, this call will block until there is again enough
  * space in the FIFO, so calling this from the "consumer" thread if no
  * other thread will call dp_fifo_shift will lead to a deadlock.
+ * Returns 0 if the item was queued, or -1 if the FIFO was flushed while
+ * waiting for space, in which case the item was not queued and remains
+ * owned by the caller.
  */
-void dp_fifo_push(Dav1dPlayPtrFifo *fifo, void *element);
+int dp_fifo_push(Dav1dPlayPtrFifo *fifo, void *element);
 
+/* Flush FIFO
+ *
+ * Remove all items from the FIFO and destroy them. Must be called
+ * from the thread shifting items.
+ */
 void dp_fifo_flush(Dav1dPlayPtrFifo *fifo, void (*destroy_elem)(void *));
+
+/* Count FIFO items
+ *
+ * Return the number of items in the FIFO, e.g. for statistics.
+ * May be called from any thread.
+ */
+size_t dp_fifo_count(Dav1dPlayPtrFifo *fifo);
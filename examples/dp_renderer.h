@@ -61,6 +61,7 @@ typedef struct {
     int untimed;
     int zerocopy;
     int gpugrain;
+    int benchmark;
 } Dav1dPlaySettings;
 
 #define WINDOW_WIDTH  910
@@ -31,6 +31,8 @@
 
 typedef int atomic_int;
 typedef unsigned int atomic_uint;
+typedef unsigned long long atomic_ullong;
+typedef __UINTPTR_TYPE__ atomic_uintptr_t;
 
 #define memory_order_relaxed __ATOMIC_RELAXED
 #define memory_order_acquire __ATOMIC_ACQUIRE
@@ -43,6 +43,7 @@
 
 typedef volatile LONG  atomic_int;
 typedef volatile ULONG atomic_uint;
+typedef volatile ULONG_PTR atomic_uintptr_t;
 
 typedef enum {
     memory_order_relaxed,
@@ -52,7 +53,14 @@ typedef enum {
 #define atomic_init(p_a, v)           do { *(p_a) = (v); } while(0)
 #define atomic_store(p_a, v)          InterlockedExchange((LONG*)p_a, v)
 #define atomic_load(p_a)              InterlockedCompareExchange((LONG*)p_a, 0, 0)
-#define atomic_exchange(p_a, v)       InterlockedExchange(p_a, v)
+#ifdef _WIN64
+#define atomic_exchange(p_a, v) \
+    (sizeof(*(p_a)) == sizeof(LONG64) ? \
+     (LONG64)InterlockedExchange64((LONG64 *)(p_a), (LONG64)(v)) : \
+     (LONG64)InterlockedExchange((LONG *)(p_a), (LONG)(v)))
+#else
+#define atomic_exchange(p_a, v)       InterlockedExchange((LONG *)(p_a), (LONG)(v))
+#endif
 #define atomic_load_explicit(p_a, mo) atomic_load(p_a)
 
 static inline int atomic_compare_exchange_strong_int(LONG *obj, LONG *expected,
@@ -62,7 +70,21 @@ static inline int atomic_compare_exchange_strong_int(LONG *obj, LONG *expected,
     *expected = InterlockedCompareExchange(obj, desired, orig);
     return *expected == orig;
 }
+#ifdef _WIN64
+static inline int atomic_compare_exchange_strong_int64(LONG64 *obj, LONG64 *expected,
+                                                       LONG64 desired)
+{
+    LONG64 orig = *expected;
+    *expected = InterlockedCompareExchange64(obj, desired, orig);
+    return *expected == orig;
+}
+#define atomic_compare_exchange_strong(p_a, expected, desired) \
+    (sizeof(*(p_a)) == sizeof(LONG64) ? \
+     atomic_compare_exchange_strong_int64((LONG64 *)p_a, (LONG64 *)expected, (LONG64)desired) : \
+     atomic_compare_exchange_strong_int((LONG *)p_a, (LONG *)expected, (LONG)desired))
+#else
 #define atomic_compare_exchange_strong(p_a, expected, desired) atomic_compare_exchange_strong_int((LONG *)p_a, (LONG *)expected, (LONG)desired)
+#endif
 
 /*
  * TODO use a special call to increment/decrement
@@ -75,9 +75,20 @@ enum Dav1dDecodeFrameType {
     DAV1D_DECODEFRAMETYPE_KEY   = 3, ///< decode and return keyframes only
 };
 
+enum Dav1dThreadAffinity {
+    DAV1D_THREAD_AFFINITY_NONE = 0, ///< leave the placement of worker threads to the OS
+    DAV1D_THREAD_AFFINITY_L3   = 1, ///< confine the worker threads of a decoder to the CPUs
+                                    ///< sharing one L3 cache (e.g. one CCX of a chiplet CPU),
+                                    ///< decoders are spread over the L3 domains in the order
+                                    ///< they are opened
+};
+
 typedef struct Dav1dSettings {
     int n_threads; ///< number of threads (0 = number of logical cores in host system, default 0)
-    int max_frame_delay; ///< Set to 1 for low-latency decoding (0 = ceil(sqrt(n_threads)), default 0)
+    int max_frame_delay; ///< Set to 1 for low-latency decoding (0 = ceil(sqrt(n_threads)), or
+                         ///< n_threads if decode_frame_type only selects intra frames, each
+                         ///< frame in flight holding one picture and its decoding buffers,
+                         ///< default 0)
     int apply_grain; ///< whether to apply film grain on output frames (default 1)
     int operating_point; ///< select an operating point for scalable AV1 bitstreams (0 - 31, default 0)
     int all_layers; ///< output all spatial layers of a scalable AV1 biststream (default 1)
@@ -93,8 +104,57 @@ typedef struct Dav1dSettings {
                                  ///< once when shown, default 0)
     enum Dav1dInloopFilterType inloop_filters; ///< postfilters to enable during decoding (default
                                                ///< DAV1D_INLOOPFILTER_ALL)
-    enum Dav1dDecodeFrameType decode_frame_type; ///< frame types to decode (default
+    enum Dav1dDecodeFrameType decode_frame_type; ///< frame types to decode; INTRA and KEY
+                                                 ///< raise the default frame delay, see
+                                                 ///< max_frame_delay (default
                                                  ///< DAV1D_DECODEFRAMETYPE_ALL)
+    int decode_stats; ///< attach Dav1dDecodeStats to each output picture (default 0)
+    int perf_counters; ///< collect hardware performance counters per task type, see
+                       ///< dav1d_get_perf_counters() (Linux only, default 0)
+    int stall_stats; ///< record why worker threads are idle, see dav1d_get_stall_stats()
+                     ///< (default 0)
+    int resync; ///< silently skip frames whose references are missing, without decoding
+                ///< their tiles, until a random access point is reached. This happens when
+                ///< joining a stream mid-GOP, or after dav1d_flush() following packet
+                ///< loss (default 0)
+    unsigned frame_block_limit; ///< maximum number of blocks decoded per frame; decoding of
+                                ///< frames exceeding it is aborted and reported through
+                                ///< DAV1D_EVENT_FLAG_FRAME_BLOCK_LIMIT (0 = unlimited, default 0)
+    enum Dav1dThreadAffinity thread_affinity; ///< placement of worker threads; with n_threads
+                                              ///< = 0, the number of threads follows the CPUs
+                                              ///< they are confined to (Linux only, default
+                                              ///< DAV1D_THREAD_AFFINITY_NONE)
+    int energy_saving; ///< keep only as many worker threads running as needed to decode
+                       ///< at the target frame rate, and park the others, see
+                       ///< dav1d_get_energy_stats() (default 0)
+    unsigned target_fps_num, target_fps_den; ///< target frame rate of energy_saving, e.g.
+                                             ///< of real-time playback (0/0 = the one
+                                             ///< signaled in the sequence header; if there
+                                             ///< is none, all threads keep running,
+                                             ///< default 0/0)
+    int parallel_gops; ///< number of closed GOPs (starting at shown key frames) decoded
+                       ///< concurrently, each by a sub-decoder using n_threads /
+                       ///< parallel_gops threads; pictures are still output in order.
+                       ///< GOPs after the one being output are decoded at most 4 times
+                       ///< the sub-decoder frame delay ahead, so this helps most with
+                       ///< short GOPs. Meant for offline use: data must be sent one
+                       ///< temporal unit at a time, and picture allocators must be
+                       ///< thread-safe. Performance and stall statistics are not
+                       ///< available (0 or 1 = off, default 0)
+    int luma_only; ///< only reconstruct the luma plane and output pictures with
+                   ///< DAV1D_PIXEL_LAYOUT_I400; chroma is still entropy-decoded, but
+                   ///< its prediction, inverse transforms, in-loop filters and film
+                   ///< grain are skipped. Decoded pictures are still allocated with
+                   ///< the signalled layout, but pictures allocated to apply film
+                   ///< grain to are allocated as I400 (default 0)
+    int entropy_only; ///< only parse the frames, without reconstructing them, and
+                      ///< attach Dav1dFrameBlockInfo to each output picture. Prediction,
+                      ///< inverse transforms, in-loop filters and film grain are skipped,
+                      ///< so the picture data is undefined. With frame threading, only
+                      ///< the entropy decoding pass is run (default 0)
+    int dirty_regions; ///< attach a Dav1dDirtyMap to each output picture, telling which
+                       ///< areas may differ from the previous shown picture (default 0)
+    int work_stats; ///< count the decoding work, see dav1d_get_work_stats() (default 0)
     uint8_t reserved[16]; ///< reserved for future use
 } Dav1dSettings;
 
@@ -277,6 +337,11 @@ enum Dav1dEventFlags {
      * new operating parameters information for the current coded sequence.
      */
     DAV1D_EVENT_FLAG_NEW_OP_PARAMS_INFO = 1 << 1,
+    /**
+     * Decoding of a frame was aborted because it exceeded
+     * Dav1dSettings.frame_block_limit.
+     */
+    DAV1D_EVENT_FLAG_FRAME_BLOCK_LIMIT = 1 << 2,
 };
 
 /**
@@ -322,6 +387,160 @@ DAV1D_API int dav1d_get_decode_error_data_props(Dav1dContext *c, Dav1dDataProps
  */
 DAV1D_API int dav1d_get_frame_delay(const Dav1dSettings *s);
 
+enum Dav1dPerfTaskType {
+    DAV1D_PERF_TASK_INIT,             ///< frame setup and CDF/tile initialization
+    DAV1D_PERF_TASK_ENTROPY,          ///< symbol decoding (first pass with frame threading)
+    DAV1D_PERF_TASK_RECONSTRUCTION,   ///< prediction and inverse transforms; without
+                                      ///< frame threading, this also includes symbol decoding
+    DAV1D_PERF_TASK_DEBLOCK,          ///< deblocking filter
+    DAV1D_PERF_TASK_CDEF,             ///< constrained directional enhancement filter
+    DAV1D_PERF_TASK_SUPER_RESOLUTION, ///< super-resolution upscaling
+    DAV1D_PERF_TASK_LOOP_RESTORATION, ///< loop restoration filter
+    DAV1D_PERF_TASK_FILM_GRAIN,       ///< film grain synthesis on worker threads
+    DAV1D_N_PERF_TASK_TYPES,
+};
+
+enum Dav1dPerfCounterFlags {
+    DAV1D_PERF_COUNTER_CYCLES         = 1 << 0,
+    DAV1D_PERF_COUNTER_INSTRUCTIONS   = 1 << 1,
+    DAV1D_PERF_COUNTER_LLC_MISSES     = 1 << 2,
+    DAV1D_PERF_COUNTER_STALLED_CYCLES = 1 << 3, ///< backend stall cycles
+};
+
+typedef struct Dav1dTaskPerfCounters {
+    uint64_t runs; ///< number of measured executions of this task type
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t llc_misses;
+    uint64_t stalled_cycles;
+} Dav1dTaskPerfCounters;
+
+typedef struct Dav1dPerfCounters {
+    /**
+     * Combination of DAV1D_PERF_COUNTER_* flags for the counters that are
+     * supported by the host and could be opened by all decoding threads.
+     * Counters not in this mask are reported as 0.
+     */
+    unsigned available;
+    Dav1dTaskPerfCounters task[DAV1D_N_PERF_TASK_TYPES];
+} Dav1dPerfCounters;
+
+/**
+ * Get the hardware performance counter totals per task type, accumulated
+ * since the decoder was opened. Requires Dav1dSettings.perf_counters.
+ *
+ * @param   c Input decoder instance.
+ * @param out Where to write the counters.
+ *
+ * @return 0 on success, or < 0 (a negative DAV1D_ERR code) on error.
+ *         DAV1D_ERR(ENOSYS) is returned if counters were not requested, or
+ *         if the host does not allow opening them. It is also returned with
+ *         Dav1dSettings.parallel_gops.
+ *
+ * @note Counters are only consistent while no decoding is in progress, e.g.
+ *       after all pictures have been drained. With n_threads = 1, the thread
+ *       that called dav1d_open() is measured.
+ */
+DAV1D_API int dav1d_get_perf_counters(Dav1dContext *c, Dav1dPerfCounters *out);
+
+/**
+ * Dependency that kept the highest-priority pending task from running while
+ * a worker thread was idle.
+ */
+enum Dav1dStallReason {
+    DAV1D_STALL_NO_WORK,                  ///< no frame in flight had a pending task: data
+                                          ///< is not submitted fast enough, or output
+                                          ///< pictures are not consumed (back-pressure)
+    DAV1D_STALL_ENTROPY_PROGRESS,         ///< symbol decoding of a tile or frame row
+    DAV1D_STALL_RECONSTRUCTION_PROGRESS,  ///< reconstruction of a tile or frame row
+    DAV1D_STALL_REFERENCE_PROGRESS,       ///< decoding of a reference frame, up to the
+                                          ///< lowest pixel used by motion compensation
+    DAV1D_STALL_DEBLOCK_PROGRESS,         ///< deblocking of the previous superblock row
+    DAV1D_STALL_CDF,                      ///< entropy contexts of the previous frame
+    DAV1D_STALL_LINE_BUFFER,              ///< post-filtering of an earlier superblock row
+                                          ///< still using the line buffer slot
+    DAV1D_STALL_PARKED,                   ///< none: the thread was parked by energy saving
+                                          ///< mode, as fewer threads sufficed
+    DAV1D_N_STALL_REASONS,
+};
+
+typedef struct Dav1dStallStats {
+    int n_threads; ///< number of worker threads
+    uint64_t busy_time; ///< time worker threads spent not waiting for tasks, summed over
+                        ///< threads, in nanoseconds
+    uint64_t stall_time[DAV1D_N_STALL_REASONS]; ///< idle time per blocking dependency,
+                                                ///< summed over threads, in nanoseconds
+    uint64_t stalls[DAV1D_N_STALL_REASONS]; ///< number of idle periods per blocking dependency
+} Dav1dStallStats;
+
+/**
+ * Get the idle time of the worker threads, attributed to the dependency that
+ * blocked the next task, accumulated since the decoder was opened. Requires
+ * Dav1dSettings.stall_stats. The reason with the largest share of the idle
+ * time is the critical path of the stream, e.g. DAV1D_STALL_ENTROPY_PROGRESS
+ * indicates that there are too few tiles to keep all threads busy.
+ *
+ * @param   c Input decoder instance.
+ * @param out Where to write the statistics.
+ *
+ * @return 0 on success, or < 0 (a negative DAV1D_ERR code) on error.
+ *         DAV1D_ERR(ENOSYS) is returned if statistics were not requested, or
+ *         if the decoder does not use worker threads (n_threads = 1). It is
+ *         also returned with Dav1dSettings.parallel_gops.
+ */
+DAV1D_API int dav1d_get_stall_stats(Dav1dContext *c, Dav1dStallStats *out);
+
+typedef struct Dav1dEnergyStats {
+    int n_threads; ///< number of worker threads
+    int active_threads; ///< number of worker threads currently allowed to run
+    uint64_t frames; ///< number of pictures output
+    uint64_t time; ///< time from the first to the last picture output, in nanoseconds
+    uint64_t busy_time; ///< time worker threads spent running tasks, summed over threads,
+                        ///< in nanoseconds (i.e. the active core time)
+    uint64_t active_time; ///< time worker threads were allowed to run, summed over threads,
+                          ///< in nanoseconds
+} Dav1dEnergyStats;
+
+/**
+ * Get the statistics of energy saving mode, accumulated since the decoder was
+ * opened. Requires Dav1dSettings.energy_saving. The achieved frame rate is
+ * frames * 1e9 / time, and the core time used per picture is busy_time /
+ * frames.
+ *
+ * @param   c Input decoder instance.
+ * @param out Where to write the statistics.
+ *
+ * @return 0 on success, or < 0 (a negative DAV1D_ERR code) on error.
+ *         DAV1D_ERR(ENOSYS) is returned if energy saving was not requested, or
+ *         if the decoder does not use worker threads (n_threads = 1).
+ */
+DAV1D_API int dav1d_get_energy_stats(Dav1dContext *c, Dav1dEnergyStats *out);
+
+typedef struct Dav1dWorkStats {
+    uint64_t frames; ///< number of frames submitted for decoding
+    uint64_t blocks; ///< number of coding blocks decoded
+    uint64_t coefs; ///< number of coefficient tokens decoded, i.e. the end-of-block
+                    ///< positions plus one, summed over all coded transform blocks
+    uint64_t tasks; ///< number of tasks run by the worker threads (0 if n_threads = 1)
+} Dav1dWorkStats;
+
+/**
+ * Get the amount of decoding work done since the decoder was opened, if
+ * Dav1dSettings.work_stats is set. Unlike timings, the block and coefficient
+ * counts are deterministic, so they can be related to the input size to find
+ * inputs that are disproportionately expensive to decode.
+ * Blocks, coefficients and tasks of a frame are only included once it has
+ * been fully decoded, e.g. after all pictures have been returned.
+ *
+ * @param   c Input decoder instance.
+ * @param out Where to write the statistics.
+ *
+ * @return 0 on success, or < 0 (a negative DAV1D_ERR code) on error.
+ *         DAV1D_ERR(ENOSYS) is returned if work_stats is not set, or with
+ *         Dav1dSettings.parallel_gops.
+ */
+DAV1D_API int dav1d_get_work_stats(Dav1dContext *c, Dav1dWorkStats *out);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
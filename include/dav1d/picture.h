@@ -43,6 +43,9 @@ extern "C" {
  * instructions. */
 #define DAV1D_PICTURE_ALIGNMENT 64
 
+/* Width and height of the cells of Dav1dDirtyMap (in luma pixels). */
+#define DAV1D_DIRTY_MAP_CELL_SIZE 64
+
 typedef struct Dav1dPictureParameters {
     int w; ///< width (in pixels)
     int h; ///< height (in pixels)
@@ -50,6 +53,82 @@ typedef struct Dav1dPictureParameters {
     int bpc; ///< bits per pixel component (8 or 10)
 } Dav1dPictureParameters;
 
+enum Dav1dDecodeStage {
+    DAV1D_DECODE_STAGE_INIT,           ///< frame setup and CDF/tile initialization
+    DAV1D_DECODE_STAGE_ENTROPY,        ///< symbol decoding (first pass with frame threading)
+    DAV1D_DECODE_STAGE_RECONSTRUCTION, ///< prediction and inverse transforms; without
+                                       ///< frame threading, this also includes symbol decoding
+    DAV1D_DECODE_STAGE_FILTER,         ///< deblocking, CDEF, super-resolution and loop restoration
+    DAV1D_DECODE_STAGE_FILM_GRAIN,     ///< film grain synthesis on output
+    DAV1D_N_DECODE_STAGES,
+};
+
+/**
+ * Decoding cost of a picture, see Dav1dSettings.decode_stats.
+ */
+typedef struct Dav1dDecodeStats {
+    uint64_t wall_time; ///< time from frame submission to decoding completion (in ns)
+    uint64_t cpu_time; ///< time spent in all threads working on this frame (in ns)
+    size_t compressed_size; ///< size of the coded tile data of this frame (in bytes)
+    int n_tiles; ///< number of tiles in this frame
+    /**
+     * Share of cpu_time spent in each Dav1dDecodeStage. The fractions add
+     * up to 1 if cpu_time is non-zero.
+     */
+    float stage_fraction[DAV1D_N_DECODE_STAGES];
+} Dav1dDecodeStats;
+
+/**
+ * Coded parameters of a block, see Dav1dSettings.entropy_only.
+ */
+typedef struct Dav1dBlockInfo {
+    uint16_t x, y; ///< position of the top-left corner (in units of 4 luma pixels,
+                   ///< before super-resolution upscaling)
+    uint8_t w, h; ///< block size, not clipped to the frame (in units of 4 luma pixels)
+    uint8_t intra; ///< 1 for intra blocks, 0 for inter and IntraBC blocks
+    uint8_t skip; ///< 1 if the block has no coded residual
+    uint8_t seg_id; ///< segment ID
+    uint8_t qindex; ///< quantizer index, after delta q and segmentation
+    /**
+     * Luma prediction mode, numbered as YMode in the AV1 specification:
+     * 0-12 for intra modes, 13-16 for single reference and 17-24 for compound
+     * inter modes. IntraBC blocks use DC_PRED (0).
+     */
+    uint8_t mode;
+    uint8_t uv_mode; ///< chroma prediction mode of intra blocks with chroma (13 = CFL),
+                     ///< 0 otherwise
+    /**
+     * Reference frames of inter blocks (1 = LAST to 7 = ALTREF, 0 = the current
+     * frame for IntraBC); ref[1] is -1 unless the block is compound. Both are
+     * -1 for intra blocks.
+     */
+    int8_t ref[2];
+    int16_t mv[2][2]; ///< motion vector { y, x } for each ref[] (in 1/8 luma pixels)
+    unsigned n_coefs; ///< number of coded coefficients, i.e. the end-of-block position
+                      ///< + 1 per coded transform block, summed over the block
+} Dav1dBlockInfo;
+
+/**
+ * Coded blocks of a picture, see Dav1dSettings.entropy_only.
+ */
+typedef struct Dav1dFrameBlockInfo {
+    Dav1dBlockInfo *blocks; ///< in raster order of their top-left corner
+    size_t n_blocks; ///< number of entries in blocks
+} Dav1dFrameBlockInfo;
+
+/**
+ * Areas of a picture that may differ from the previous shown picture, see
+ * Dav1dSettings.dirty_regions. The picture is split into cells of
+ * DAV1D_DIRTY_MAP_CELL_SIZE luma pixels (smaller on the right and bottom
+ * edges); cells marked unchanged are identical to the previous shown picture
+ * in all planes. This is conservative: changed cells may still be identical.
+ */
+typedef struct Dav1dDirtyMap {
+    int w, h; ///< number of columns and rows of cells
+    int n_dirty; ///< number of changed cells, w * h if the whole picture changed
+    uint8_t *dirty; ///< [h][w]; 1 if the cell may have changed, 0 if it is unchanged
+} Dav1dDirtyMap;
+
 typedef struct Dav1dPicture {
     Dav1dSequenceHeader *seq_hdr;
     Dav1dFrameHeader *frame_hdr;
@@ -91,14 +170,35 @@ typedef struct Dav1dPicture {
      */
     size_t n_itut_t35;
 
-    uintptr_t reserved[4]; ///< reserved for future use
+    /**
+     * Decoding cost of this picture, if enabled with Dav1dSettings.decode_stats
+     */
+    Dav1dDecodeStats *decode_stats;
+
+    /**
+     * Coded blocks of this picture, if enabled with Dav1dSettings.entropy_only
+     */
+    Dav1dFrameBlockInfo *block_info;
+
+    /**
+     * Changes since the previous shown picture, if enabled with
+     * Dav1dSettings.dirty_regions. NULL if unknown, e.g. for pictures that
+     * are shown again (show_existing_frame); the whole picture may have
+     * changed then.
+     */
+    Dav1dDirtyMap *dirty_map;
+
+    uintptr_t reserved[1]; ///< reserved for future use
 
     struct Dav1dRef *frame_hdr_ref; ///< Dav1dFrameHeader allocation origin
     struct Dav1dRef *seq_hdr_ref; ///< Dav1dSequenceHeader allocation origin
     struct Dav1dRef *content_light_ref; ///< Dav1dContentLightLevel allocation origin
     struct Dav1dRef *mastering_display_ref; ///< Dav1dMasteringDisplay allocation origin
     struct Dav1dRef *itut_t35_ref; ///< Dav1dITUTT35 allocation origin
-    uintptr_t reserved_ref[4]; ///< reserved for future use
+    struct Dav1dRef *decode_stats_ref; ///< Dav1dDecodeStats allocation origin
+    struct Dav1dRef *block_info_ref; ///< Dav1dFrameBlockInfo allocation origin
+    struct Dav1dRef *dirty_map_ref; ///< Dav1dDirtyMap allocation origin
+    uintptr_t reserved_ref[1]; ///< reserved for future use
     struct Dav1dRef *ref; ///< Frame data allocation origin
 
     void *allocator_data; ///< pointer managed by the allocator
@@ -117,9 +117,13 @@ void bytefn(dav1d_cdef_brow)(Dav1dTaskContext *const tc,
     const uint8_t *uv_dir = uv_dirs[layout == DAV1D_PIXEL_LAYOUT_I422];
     const int have_tt = f->c->n_tc > 1;
     const int sb128 = f->seq_hdr->sb128;
+    // chroma is not reconstructed with luma_only, so leave it unfiltered
+    const int luma_only = f->c->luma_only;
     const int resize = f->frame_hdr->width[0] != f->frame_hdr->width[1];
     const ptrdiff_t y_stride = PXSTRIDE(f->cur.stride[0]);
     const ptrdiff_t uv_stride = PXSTRIDE(f->cur.stride[1]);
+    // slot of this sbrow in the line buffer ring
+    const int ring_sby = sby % f->lf.line_buf_sbh;
 
     for (int bit = 0, by = by_start; by < by_end; by += 2, edges |= CDEF_HAVE_TOP) {
         const int tf = tc->top_pre_cdef_toggle;
@@ -131,11 +135,12 @@ void bytefn(dav1d_cdef_brow)(Dav1dTaskContext *const tc,
         {
             // backup pre-filter data for next iteration
             pixel *const cdef_top_bak[3] = {
-                f->lf.cdef_line[!tf][0] + have_tt * sby * 4 * y_stride,
-                f->lf.cdef_line[!tf][1] + have_tt * sby * 8 * uv_stride,
-                f->lf.cdef_line[!tf][2] + have_tt * sby * 8 * uv_stride
+                f->lf.cdef_line[!tf][0] + have_tt * ring_sby * 4 * y_stride,
+                f->lf.cdef_line[!tf][1] + have_tt * ring_sby * 8 * uv_stride,
+                f->lf.cdef_line[!tf][2] + have_tt * ring_sby * 8 * uv_stride
             };
-            backup2lines(cdef_top_bak, ptrs, f->cur.stride, layout);
+            backup2lines(cdef_top_bak, ptrs, f->cur.stride,
+                         luma_only ? DAV1D_PIXEL_LAYOUT_I400 : layout);
         }
 
         ALIGN_STK_16(pixel, lr_bak, 2 /* idx */, [3 /* plane */][8 /* y */][2 /* x */]);
@@ -149,7 +154,7 @@ void bytefn(dav1d_cdef_brow)(Dav1dTaskContext *const tc,
             const int cdef_idx = lflvl[sb128x].cdef_idx[sb64_idx];
             if (cdef_idx == -1 ||
                 (!f->frame_hdr->cdef.y_strength[cdef_idx] &&
-                 !f->frame_hdr->cdef.uv_strength[cdef_idx]))
+                 (luma_only || !f->frame_hdr->cdef.uv_strength[cdef_idx])))
             {
                 last_skip = 1;
                 goto next_sb;
@@ -161,7 +166,7 @@ void bytefn(dav1d_cdef_brow)(Dav1dTaskContext *const tc,
                                                     noskip_row[0][0];
 
             const int y_lvl = f->frame_hdr->cdef.y_strength[cdef_idx];
-            const int uv_lvl = f->frame_hdr->cdef.uv_strength[cdef_idx];
+            const int uv_lvl = luma_only ? 0 : f->frame_hdr->cdef.uv_strength[cdef_idx];
             const enum Backup2x8Flags flag = !!y_lvl + (!!uv_lvl << 1);
 
             const int y_pri_lvl = (y_lvl >> 2) << bitdepth_min_8;
@@ -211,26 +216,26 @@ void bytefn(dav1d_cdef_brow)(Dav1dTaskContext *const tc,
                 if (!have_tt) goto st_y;
                 if (sbrow_start && by == by_start) {
                     if (resize) {
-                        offset = (sby - 1) * 4 * y_stride + bx * 4;
+                        offset = (ring_sby - 1) * 4 * y_stride + bx * 4;
                         top = &f->lf.cdef_lpf_line[0][offset];
                     } else {
-                        offset = (sby * (4 << sb128) - 4) * y_stride + bx * 4;
+                        offset = (ring_sby * (4 << sb128) - 4) * y_stride + bx * 4;
                         top = &f->lf.lr_lpf_line[0][offset];
                     }
                     bot = bptrs[0] + 8 * y_stride;
                 } else if (!sbrow_start && by + 2 >= by_end) {
-                    top = &f->lf.cdef_line[tf][0][sby * 4 * y_stride + bx * 4];
+                    top = &f->lf.cdef_line[tf][0][ring_sby * 4 * y_stride + bx * 4];
                     if (resize) {
-                        offset = (sby * 4 + 2) * y_stride + bx * 4;
+                        offset = (ring_sby * 4 + 2) * y_stride + bx * 4;
                         bot = &f->lf.cdef_lpf_line[0][offset];
                     } else {
-                        const int line = sby * (4 << sb128) + 4 * sb128 + 2;
+                        const int line = ring_sby * (4 << sb128) + 4 * sb128 + 2;
                         offset = line * y_stride + bx * 4;
                         bot = &f->lf.lr_lpf_line[0][offset];
                     }
                 } else {
             st_y:;
-                    offset = sby * 4 * y_stride;
+                    offset = ring_sby * 4 * y_stride;
                     top = &f->lf.cdef_line[tf][0][have_tt * offset + bx * 4];
                     bot = bptrs[0] + 8 * y_stride;
                 }
@@ -253,29 +258,29 @@ void bytefn(dav1d_cdef_brow)(Dav1dTaskContext *const tc,
                     if (!have_tt) goto st_uv;
                     if (sbrow_start && by == by_start) {
                         if (resize) {
-                            offset = (sby - 1) * 4 * uv_stride + (bx * 4 >> ss_hor);
+                            offset = (ring_sby - 1) * 4 * uv_stride + (bx * 4 >> ss_hor);
                             top = &f->lf.cdef_lpf_line[pl][offset];
                         } else {
-                            const int line = sby * (4 << sb128) - 4;
+                            const int line = ring_sby * (4 << sb128) - 4;
                             offset = line * uv_stride + (bx * 4 >> ss_hor);
                             top = &f->lf.lr_lpf_line[pl][offset];
                         }
                         bot = bptrs[pl] + (8 >> ss_ver) * uv_stride;
                     } else if (!sbrow_start && by + 2 >= by_end) {
-                        const ptrdiff_t top_offset = sby * 8 * uv_stride +
+                        const ptrdiff_t top_offset = ring_sby * 8 * uv_stride +
                                                      (bx * 4 >> ss_hor);
                         top = &f->lf.cdef_line[tf][pl][top_offset];
                         if (resize) {
-                            offset = (sby * 4 + 2) * uv_stride + (bx * 4 >> ss_hor);
+                            offset = (ring_sby * 4 + 2) * uv_stride + (bx * 4 >> ss_hor);
                             bot = &f->lf.cdef_lpf_line[pl][offset];
                         } else {
-                            const int line = sby * (4 << sb128) + 4 * sb128 + 2;
+                            const int line = ring_sby * (4 << sb128) + 4 * sb128 + 2;
                             offset = line * uv_stride + (bx * 4 >> ss_hor);
                             bot = &f->lf.lr_lpf_line[pl][offset];
                         }
                     } else {
                 st_uv:;
-                        const ptrdiff_t offset = sby * 8 * uv_stride;
+                        const ptrdiff_t offset = ring_sby * 8 * uv_stride;
                         top = &f->lf.cdef_line[tf][pl][have_tt * offset + (bx * 4 >> ss_hor)];
                         bot = bptrs[pl] + (8 >> ss_ver) * uv_stride;
                     }
@@ -44,6 +44,10 @@
 #ifdef HAVE_PTHREAD_NP_H
 #include <pthread_np.h>
 #endif
+#ifdef HAVE_CPU_TOPOLOGY
+#include <limits.h>
+#include <stdio.h>
+#endif
 #if defined(__FreeBSD__)
 #define cpu_set_t cpuset_t
 #endif
@@ -103,3 +107,128 @@ COLD int dav1d_num_logical_processors(Dav1dContext *const c) {
         dav1d_log(c, "Unable to detect thread count, defaulting to single-threaded mode\n");
     return 1;
 }
+
+#ifdef HAVE_CPU_TOPOLOGY
+// parses a sysfs cpu list, e.g. "0-7,16-23"
+static int read_cpu_list(const char *const path, cpu_set_t *const set) {
+    FILE *const f = fopen(path, "r");
+    if (!f) return -1;
+    CPU_ZERO(set);
+    int res = -1;
+    unsigned first, last;
+    while (fscanf(f, "%u", &first) == 1) {
+        int c = fgetc(f);
+        last = first;
+        if (c == '-') {
+            if (fscanf(f, "%u", &last) != 1) break;
+            c = fgetc(f);
+        }
+        for (unsigned n = first; n <= last && n < CPU_SETSIZE; n++)
+            CPU_SET(n, set);
+        res = 0;
+        if (c != ',') break;
+    }
+    fclose(f);
+    return res;
+}
+
+static int read_l3_cpus(const char *const root, const int cpu,
+                        cpu_set_t *const set)
+{
+    char path[512];
+    for (int idx = 0;; idx++) {
+        snprintf(path, sizeof(path), "%s/cpu%d/cache/index%d/level",
+                 root, cpu, idx);
+        FILE *const f = fopen(path, "r");
+        if (!f) return -1;
+        int level;
+        const int res = fscanf(f, "%d", &level);
+        fclose(f);
+        if (res == 1 && level == 3) {
+            snprintf(path, sizeof(path), "%s/cpu%d/cache/index%d/shared_cpu_list",
+                     root, cpu, idx);
+            return read_cpu_list(path, set);
+        }
+    }
+}
+
+static int read_cpu_value(const char *const root, const int cpu,
+                          const char *const name, unsigned *const value)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/cpu%d/%s", root, cpu, name);
+    FILE *const f = fopen(path, "r");
+    if (!f) return -1;
+    const int res = fscanf(f, "%u", value);
+    fclose(f);
+    return res == 1 ? 0 : -1;
+}
+
+// returns the number of L3 domains in allowed, and the CPUs of domain target
+static int get_l3_domains(const cpu_set_t *const allowed, const int target,
+                          cpu_set_t *const set)
+{
+    cpu_set_t seen, domain;
+    CPU_ZERO(&seen);
+    int n_domains = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, allowed) || CPU_ISSET(cpu, &seen)) continue;
+        if (read_l3_cpus(DAV1D_SYSFS_CPU_ROOT, cpu, &domain)) return 0;
+        CPU_AND(&domain, &domain, allowed);
+        CPU_SET(cpu, &domain);
+        CPU_OR(&seen, &seen, &domain);
+        if (n_domains++ == target) *set = domain;
+    }
+    return n_domains;
+}
+
+COLD int dav1d_get_l3_domain(const unsigned idx, cpu_set_t *const set) {
+    cpu_set_t allowed;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed))
+        return 0;
+    const int n_domains = get_l3_domains(&allowed, -1, set);
+    if (n_domains)
+        get_l3_domains(&allowed, idx % n_domains, set);
+    return n_domains;
+}
+
+COLD int dav1d_get_fast_cpus(const char *const root, const cpu_set_t *cpus,
+                             cpu_set_t *const fast)
+{
+    cpu_set_t allowed;
+    if (!cpus) {
+        if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed))
+            return 0;
+        cpus = &allowed;
+    }
+    // cpu_capacity is normalized to 1024 for the fastest CPU of the system,
+    // the maximum frequency is a fallback for systems which don't expose it
+    static const char *const sources[] = {
+        "cpu_capacity", "cpufreq/cpuinfo_max_freq"
+    };
+    for (int src = 0; src < 2; src++) {
+        unsigned max = 0, min = UINT_MAX, cap;
+        int cpu;
+        for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, cpus)) continue;
+            if (read_cpu_value(root, cpu, sources[src], &cap)) break;
+            if (cap > max) max = cap;
+            if (cap < min) min = cap;
+        }
+        if (cpu < CPU_SETSIZE || !max) continue;
+        // CPUs within 1/8th of the fastest one (e.g. the favored cores of
+        // a turbo boosting CPU) are not worth telling apart
+        if (min * 8ULL >= max * 7ULL) return 0;
+        CPU_ZERO(fast);
+        for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, cpus) &&
+                !read_cpu_value(root, cpu, sources[src], &cap) &&
+                cap * 8ULL >= max * 7ULL)
+            {
+                CPU_SET(cpu, fast);
+            }
+        return CPU_COUNT(fast);
+    }
+    return 0;
+}
+#endif
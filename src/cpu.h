@@ -54,6 +54,31 @@ void dav1d_init_cpu(void);
 DAV1D_API void dav1d_set_cpu_flags_mask(unsigned mask);
 int dav1d_num_logical_processors(Dav1dContext *c);
 
+#if defined(__linux__) && defined(HAVE_PTHREAD_GETAFFINITY_NP) && \
+    defined(HAVE_PTHREAD_SETAFFINITY_NP)
+#include <sched.h>
+
+#define HAVE_CPU_TOPOLOGY 1
+#define DAV1D_SYSFS_CPU_ROOT "/sys/devices/system/cpu"
+
+/*
+ * Groups the CPUs the calling thread may run on by the L3 cache they share,
+ * as described by the sysfs cpu topology. Domains are numbered in the order
+ * of their lowest CPU. Returns the number of domains, and sets *set to the
+ * CPUs of domain idx % n, or returns 0 if the topology is unknown.
+ */
+int dav1d_get_l3_domain(unsigned idx, cpu_set_t *set);
+
+/*
+ * Reads the relative performance of the CPUs in *cpus (or of those the
+ * calling thread may run on, if NULL) from cpuN/cpu_capacity, or else from
+ * cpuN/cpufreq/cpuinfo_max_freq, under root. On heterogeneous (hybrid)
+ * systems, returns the number of fast CPUs and sets *fast to them; returns 0
+ * if all CPUs perform alike, or if their capacity is unknown.
+ */
+int dav1d_get_fast_cpus(const char *root, const cpu_set_t *cpus, cpu_set_t *fast);
+#endif
+
 static ALWAYS_INLINE unsigned dav1d_get_cpu_flags(void) {
     unsigned flags = dav1d_cpu_flags & dav1d_cpu_flags_mask;
 
@@ -38,6 +38,7 @@
 #include "common/frame.h"
 #include "common/intops.h"
 
+#include "src/clock.h"
 #include "src/ctx.h"
 #include "src/decode.h"
 #include "src/dequant_tables.h"
@@ -49,6 +50,7 @@
 #include "src/ref.h"
 #include "src/tables.h"
 #include "src/thread_task.h"
+#include "src/trace.h"
 #include "src/warpmv.h"
 
 static void init_quant_tables(const Dav1dSequenceHeader *const seq_hdr,
@@ -692,6 +694,82 @@ static void obmc_lowest_px(Dav1dTaskContext *const t,
         }
 }
 
+// Record the coded parameters of a block for Dav1dSettings.entropy_only. Each
+// block owns the slot of its top-left 4x4 unit, so tiles decoded in parallel
+// never write to the same entry; the slots are compacted on frame exit.
+static void add_block_info(Dav1dTaskContext *const t, const enum BlockSize bs,
+                           const Av1Block *const b, const int has_chroma,
+                           const unsigned n_coefs)
+{
+    const Dav1dFrameContext *const f = t->f;
+    const Dav1dFrameHeader *const frame_hdr = f->frame_hdr;
+    const uint8_t *const b_dim = dav1d_block_dimensions[bs];
+    Dav1dBlockInfo *const bi = &f->block_info.data->blocks[t->by * f->bw + t->bx];
+
+    bi->x = t->bx;
+    bi->y = t->by;
+    bi->w = b_dim[0];
+    bi->h = b_dim[1];
+    bi->intra = b->intra;
+    bi->skip = b->skip;
+    bi->seg_id = b->seg_id;
+    bi->qindex = frame_hdr->segmentation.enabled ?
+        iclip_u8(t->ts->last_qidx + frame_hdr->segmentation.seg_data.d[b->seg_id].delta_q) :
+        t->ts->last_qidx;
+    bi->n_coefs = n_coefs;
+    memset(bi->mv, 0, sizeof(bi->mv));
+    if (b->intra) {
+        bi->mode = b->y_mode == FILTER_PRED ? DC_PRED : b->y_mode;
+        bi->uv_mode = has_chroma ? b->uv_mode : 0;
+        bi->ref[0] = bi->ref[1] = -1;
+    } else if (!IS_INTER_OR_SWITCH(frame_hdr)) { // intrabc
+        bi->mode = DC_PRED;
+        bi->uv_mode = 0;
+        bi->ref[0] = 0;
+        bi->ref[1] = -1;
+        bi->mv[0][0] = b->mv[0].y;
+        bi->mv[0][1] = b->mv[0].x;
+    } else {
+        const int comp = b->comp_type != COMP_INTER_NONE;
+        // YMode numbering of the specification, see 6.10.22
+        bi->mode = comp ? 17 + b->inter_mode : 13 + b->inter_mode;
+        bi->uv_mode = 0;
+        for (int i = 0; i < 2; i++) {
+            if (i && !comp) {
+                bi->ref[1] = -1;
+                break;
+            }
+            bi->ref[i] = b->ref[i] + 1;
+            bi->mv[i][0] = b->mv[i].y;
+            bi->mv[i][1] = b->mv[i].x;
+        }
+    }
+}
+
+// Whether a block is an exact copy of the previous shown picture, before
+// in-loop filtering: no residual, and a zero-motion translation from it. The
+// average of two identical predictions is exact, so compound blocks qualify
+// if both references are that picture, unless they are masked.
+static int is_copied_block(const Dav1dFrameContext *const f, const Av1Block *const b) {
+    if (b->intra || !b->skip) return 0;
+    const unsigned ref_mask = f->dirty.ref_mask;
+    switch (b->comp_type) {
+    case COMP_INTER_NONE:
+        return b->motion_mode == MM_TRANSLATION &&
+               b->interintra_type == INTER_INTRA_NONE && !b->mv[0].n &&
+               (ref_mask >> b->ref[0]) & 1 &&
+               !(b->inter_mode == GLOBALMV && f->gmv_warp_allowed[b->ref[0]]);
+    case COMP_INTER_AVG:
+    case COMP_INTER_WEIGHTED_AVG:
+        return !b->mv[0].n && !b->mv[1].n &&
+               (ref_mask >> b->ref[0]) & (ref_mask >> b->ref[1]) & 1 &&
+               !(b->inter_mode == GLOBALMV_GLOBALMV &&
+                 (f->gmv_warp_allowed[b->ref[0]] || f->gmv_warp_allowed[b->ref[1]]));
+    default:
+        return 0;
+    }
+}
+
 static int decode_b(Dav1dTaskContext *const t,
                     const enum BlockLevel bl,
                     const enum BlockSize bs,
@@ -700,6 +778,8 @@ static int decode_b(Dav1dTaskContext *const t,
 {
     Dav1dTileState *const ts = t->ts;
     const Dav1dFrameContext *const f = t->f;
+    const unsigned n_coefs = t->n_coefs;
+    if (f->c->count_work) t->n_blocks++;
     Av1Block b_mem, *const b = t->frame_thread.pass ?
         &f->frame_thread.b[t->by * f->b4_stride + t->bx] : &b_mem;
     const uint8_t *const b_dim = dav1d_block_dimensions[bs];
@@ -1222,7 +1302,7 @@ static int decode_b(Dav1dTaskContext *const t,
         }
 
         // reconstruction
-        if (t->frame_thread.pass == 1) {
+        if (t->frame_thread.pass == 1 || f->c->entropy_only) {
             f->bd_fn.read_coef_blocks(t, bs, b);
         } else {
             f->bd_fn.recon_b_intra(t, bs, intra_edge_flags, b);
@@ -1366,7 +1446,7 @@ static int decode_b(Dav1dTaskContext *const t,
         read_vartx_tree(t, b, bs, bx4, by4);
 
         // reconstruction
-        if (t->frame_thread.pass == 1) {
+        if (t->frame_thread.pass == 1 || f->c->entropy_only) {
             f->bd_fn.read_coef_blocks(t, bs, b);
             b->filter2d = FILTER_2D_BILINEAR;
         } else {
@@ -1890,7 +1970,7 @@ static int decode_b(Dav1dTaskContext *const t,
         read_vartx_tree(t, b, bs, bx4, by4);
 
         // reconstruction
-        if (t->frame_thread.pass == 1) {
+        if (t->frame_thread.pass == 1 || f->c->entropy_only) {
             f->bd_fn.read_coef_blocks(t, bs, b);
         } else {
             if (f->bd_fn.recon_b_inter(t, bs, b)) return -1;
@@ -2079,6 +2159,15 @@ static int decode_b(Dav1dTaskContext *const t,
         }
     }
 
+    if (f->block_info.data)
+        add_block_info(t, bs, b, has_chroma, t->n_coefs - n_coefs);
+    if (f->dirty.ref_mask) {
+        const int copied = is_copied_block(f, b);
+        uint8_t *copied_ptr = &f->dirty.copied[t->by * f->b4_stride + t->bx];
+        for (int y = 0; y < h4; y++, copied_ptr += f->b4_stride)
+            memset(copied_ptr, copied, w4);
+    }
+
     return 0;
 }
 
@@ -2095,13 +2184,14 @@ static int checked_decode_b(Dav1dTaskContext *const t,
     const Dav1dFrameContext *const f = t->f;
     const int err = decode_b(t, bl, bs, bp, intra_edge_flags);
 
-    if (err == 0 && !(t->frame_thread.pass & 1)) {
+    if (err == 0 && !(t->frame_thread.pass & 1) && !f->c->entropy_only) {
         const int ss_ver = f->cur.p.layout == DAV1D_PIXEL_LAYOUT_I420;
         const int ss_hor = f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I444;
         const uint8_t *const b_dim = dav1d_block_dimensions[bs];
         const int bw4 = b_dim[0], bh4 = b_dim[1];
         const int w4 = imin(bw4, f->bw - t->bx), h4 = imin(bh4, f->bh - t->by);
         const int has_chroma = f->seq_hdr->layout != DAV1D_PIXEL_LAYOUT_I400 &&
+                               !f->c->luma_only &&
                                (bw4 > ss_hor || t->bx & 1) &&
                                (bh4 > ss_ver || t->by & 1);
 
@@ -2525,7 +2615,7 @@ static void setup_tile(Dav1dTileState *const ts,
 
     if (f->c->n_tc > 1) {
         for (int p = 0; p < 2; p++)
-            atomic_init(&ts->progress[p], row_sb_start);
+            atomic_init(&ts->progress[p].sby, row_sb_start);
     }
 }
 
@@ -2661,6 +2751,7 @@ int dav1d_decode_tile_sbrow(Dav1dTaskContext *const t) {
                                    t->by >> 1, (t->by + sb_step) >> 1);
     }
     memset(t->pal_sz_uv[1], 0, sizeof(*t->pal_sz_uv));
+    t->n_blocks = t->n_coefs = 0;
     const int sb128y = t->by >> 5;
     for (t->bx = ts->tiling.col_start, t->a = f->a + col_sb128_start + tile_row * f->sb128w,
          t->lf_mask = f->lf.mask + sb128y * f->sb128w + col_sb128_start;
@@ -2747,7 +2838,7 @@ int dav1d_decode_tile_sbrow(Dav1dTaskContext *const t) {
     }
 
     // backup pre-loopfilter pixels for intra prediction of the next sbrow
-    if (t->frame_thread.pass != 1)
+    if (t->frame_thread.pass != 1 && !c->entropy_only)
         f->bd_fn.backup_ipred_edge(t);
 
     // backup t->a/l.tx_lpf_y/uv at tile boundaries to use them to "fix"
@@ -2763,6 +2854,17 @@ int dav1d_decode_tile_sbrow(Dav1dTaskContext *const t) {
     // error out on symbol decoder overread
     if (ts->msac.cnt <= -15) return 1;
 
+    // with 2-pass decoding, the blocks are counted in the entropy pass only
+    if (c->count_work && t->frame_thread.pass != 2) {
+        Dav1dFrameContext *const fw = (Dav1dFrameContext *)f;
+        atomic_fetch_add(&fw->n_coefs, t->n_coefs);
+        const unsigned n = atomic_fetch_add(&fw->n_blocks, t->n_blocks) + t->n_blocks;
+        if (c->frame_block_limit && n > c->frame_block_limit) {
+            atomic_store(&fw->block_limit_hit, 1);
+            return 1;
+        }
+    }
+
     return c->strict_std_compliance &&
            (t->by >> f->sb_shift) + 1 >= f->frame_hdr->tiling.row_start_sb[tile_row + 1] &&
            check_trailing_bits_after_symbol_coder(&ts->msac);
@@ -2800,7 +2902,7 @@ int dav1d_decode_frame_init(Dav1dFrameContext *const f) {
             }
         }
         dav1d_free_aligned(f->ts);
-        f->ts = dav1d_alloc_aligned(ALLOC_TILE, sizeof(*f->ts) * n_ts, 32);
+        f->ts = dav1d_alloc_aligned(ALLOC_TILE, sizeof(*f->ts) * n_ts, 64);
         if (!f->ts) goto error;
         f->n_ts = n_ts;
     }
@@ -2920,15 +3022,29 @@ int dav1d_decode_frame_init(Dav1dFrameContext *const f) {
     ptrdiff_t y_stride = f->cur.stride[0], uv_stride = f->cur.stride[1];
     const int has_resize = f->frame_hdr->width[0] != f->frame_hdr->width[1];
     const int need_cdef_lpf_copy = c->n_tc > 1 && has_resize;
-    if (y_stride * f->sbh * 4 != f->lf.cdef_buf_plane_sz[0] ||
-        uv_stride * f->sbh * 8 != f->lf.cdef_buf_plane_sz[1] ||
+    // With multiple task threads, the line buffers hold a ring of sbrows
+    // rather than one slot per sbrow of the frame. The task scheduler holds
+    // back the deblocking of an sbrow until the sbrows that previously used
+    // its slot are fully post-filtered, so the ring only has to be deep
+    // enough to cover the sbrows that can be in flight at the same time.
+    const int line_buf_sbh = c->n_tc > 1 ? imin(f->sbh, c->n_tc + 2) : 1;
+    // the lpf lines additionally keep 4 lines in front of the first slot,
+    // so that the sbrow following the last slot finds the bottom lines of
+    // the previous sbrow right above its own (see dav1d_copy_lpf())
+    const int cdef_lpf_lines = line_buf_sbh * 4 + 4;
+    if (y_stride * line_buf_sbh * 4 != f->lf.cdef_buf_plane_sz[0] ||
+        uv_stride * line_buf_sbh * 8 != f->lf.cdef_buf_plane_sz[1] ||
         need_cdef_lpf_copy != f->lf.need_cdef_lpf_copy ||
-        f->sbh != f->lf.cdef_buf_sbh)
+        line_buf_sbh != f->lf.line_buf_sbh)
     {
         dav1d_free_aligned(f->lf.cdef_line_buf);
         size_t alloc_sz = 64;
-        alloc_sz += (size_t)llabs(y_stride) * 4 * f->sbh << need_cdef_lpf_copy;
-        alloc_sz += (size_t)llabs(uv_stride) * 8 * f->sbh << need_cdef_lpf_copy;
+        alloc_sz += (size_t)llabs(y_stride) * 4 * line_buf_sbh;
+        alloc_sz += (size_t)llabs(uv_stride) * 8 * line_buf_sbh;
+        if (need_cdef_lpf_copy) {
+            alloc_sz += (size_t)llabs(y_stride) * cdef_lpf_lines;
+            alloc_sz += (size_t)llabs(uv_stride) * cdef_lpf_lines * 2;
+        }
         uint8_t *ptr = f->lf.cdef_line_buf = dav1d_alloc_aligned(ALLOC_CDEF, alloc_sz, 32);
         if (!ptr) {
             f->lf.cdef_buf_plane_sz[0] = f->lf.cdef_buf_plane_sz[1] = 0;
@@ -2937,18 +3053,18 @@ int dav1d_decode_frame_init(Dav1dFrameContext *const f) {
 
         ptr += 32;
         if (y_stride < 0) {
-            f->lf.cdef_line[0][0] = ptr - y_stride * (f->sbh * 4 - 1);
-            f->lf.cdef_line[1][0] = ptr - y_stride * (f->sbh * 4 - 3);
+            f->lf.cdef_line[0][0] = ptr - y_stride * (line_buf_sbh * 4 - 1);
+            f->lf.cdef_line[1][0] = ptr - y_stride * (line_buf_sbh * 4 - 3);
         } else {
             f->lf.cdef_line[0][0] = ptr + y_stride * 0;
             f->lf.cdef_line[1][0] = ptr + y_stride * 2;
         }
-        ptr += llabs(y_stride) * f->sbh * 4;
+        ptr += llabs(y_stride) * line_buf_sbh * 4;
         if (uv_stride < 0) {
-            f->lf.cdef_line[0][1] = ptr - uv_stride * (f->sbh * 8 - 1);
-            f->lf.cdef_line[0][2] = ptr - uv_stride * (f->sbh * 8 - 3);
-            f->lf.cdef_line[1][1] = ptr - uv_stride * (f->sbh * 8 - 5);
-            f->lf.cdef_line[1][2] = ptr - uv_stride * (f->sbh * 8 - 7);
+            f->lf.cdef_line[0][1] = ptr - uv_stride * (line_buf_sbh * 8 - 1);
+            f->lf.cdef_line[0][2] = ptr - uv_stride * (line_buf_sbh * 8 - 3);
+            f->lf.cdef_line[1][1] = ptr - uv_stride * (line_buf_sbh * 8 - 5);
+            f->lf.cdef_line[1][2] = ptr - uv_stride * (line_buf_sbh * 8 - 7);
         } else {
             f->lf.cdef_line[0][1] = ptr + uv_stride * 0;
             f->lf.cdef_line[0][2] = ptr + uv_stride * 2;
@@ -2957,29 +3073,30 @@ int dav1d_decode_frame_init(Dav1dFrameContext *const f) {
         }
 
         if (need_cdef_lpf_copy) {
-            ptr += llabs(uv_stride) * f->sbh * 8;
+            ptr += llabs(uv_stride) * line_buf_sbh * 8;
             if (y_stride < 0)
-                f->lf.cdef_lpf_line[0] = ptr - y_stride * (f->sbh * 4 - 1);
+                f->lf.cdef_lpf_line[0] = ptr - y_stride * (cdef_lpf_lines - 5);
             else
-                f->lf.cdef_lpf_line[0] = ptr;
-            ptr += llabs(y_stride) * f->sbh * 4;
+                f->lf.cdef_lpf_line[0] = ptr + y_stride * 4;
+            ptr += llabs(y_stride) * cdef_lpf_lines;
             if (uv_stride < 0) {
-                f->lf.cdef_lpf_line[1] = ptr - uv_stride * (f->sbh * 4 - 1);
-                f->lf.cdef_lpf_line[2] = ptr - uv_stride * (f->sbh * 8 - 1);
+                f->lf.cdef_lpf_line[1] = ptr - uv_stride * (cdef_lpf_lines * 1 - 5);
+                f->lf.cdef_lpf_line[2] = ptr - uv_stride * (cdef_lpf_lines * 2 - 5);
             } else {
-                f->lf.cdef_lpf_line[1] = ptr;
-                f->lf.cdef_lpf_line[2] = ptr + uv_stride * f->sbh * 4;
+                f->lf.cdef_lpf_line[1] = ptr + uv_stride * 4;
+                f->lf.cdef_lpf_line[2] = ptr + uv_stride * (cdef_lpf_lines + 4);
             }
         }
 
-        f->lf.cdef_buf_plane_sz[0] = (int) y_stride * f->sbh * 4;
-        f->lf.cdef_buf_plane_sz[1] = (int) uv_stride * f->sbh * 8;
+        f->lf.cdef_buf_plane_sz[0] = (int) y_stride * line_buf_sbh * 4;
+        f->lf.cdef_buf_plane_sz[1] = (int) uv_stride * line_buf_sbh * 8;
         f->lf.need_cdef_lpf_copy = need_cdef_lpf_copy;
-        f->lf.cdef_buf_sbh = f->sbh;
+        f->lf.line_buf_sbh = line_buf_sbh;
     }
 
     const int sb128 = f->seq_hdr->sb128;
-    const int num_lines = c->n_tc > 1 ? f->sbh * 4 << sb128 : 12;
+    const int num_lines = c->n_tc > 1 ? (line_buf_sbh * 4 << sb128) + 4 : 12;
+    const int lr_top = 4 * (c->n_tc > 1);
     y_stride = f->sr_cur.p.stride[0], uv_stride = f->sr_cur.p.stride[1];
     if (y_stride * num_lines != f->lf.lr_buf_plane_sz[0] ||
         uv_stride * num_lines * 2 != f->lf.lr_buf_plane_sz[1])
@@ -2997,16 +3114,16 @@ int dav1d_decode_frame_init(Dav1dFrameContext *const f) {
 
         ptr += 64;
         if (y_stride < 0)
-            f->lf.lr_lpf_line[0] = ptr - y_stride * (num_lines - 1);
+            f->lf.lr_lpf_line[0] = ptr - y_stride * (num_lines - 1 - lr_top);
         else
-            f->lf.lr_lpf_line[0] = ptr;
+            f->lf.lr_lpf_line[0] = ptr + y_stride * lr_top;
         ptr += llabs(y_stride) * num_lines;
         if (uv_stride < 0) {
-            f->lf.lr_lpf_line[1] = ptr - uv_stride * (num_lines * 1 - 1);
-            f->lf.lr_lpf_line[2] = ptr - uv_stride * (num_lines * 2 - 1);
+            f->lf.lr_lpf_line[1] = ptr - uv_stride * (num_lines * 1 - 1 - lr_top);
+            f->lf.lr_lpf_line[2] = ptr - uv_stride * (num_lines * 2 - 1 - lr_top);
         } else {
-            f->lf.lr_lpf_line[1] = ptr;
-            f->lf.lr_lpf_line[2] = ptr + uv_stride * num_lines;
+            f->lf.lr_lpf_line[1] = ptr + uv_stride * lr_top;
+            f->lf.lr_lpf_line[2] = ptr + uv_stride * (num_lines + lr_top);
         }
 
         f->lf.lr_buf_plane_sz[0] = (int) y_stride * num_lines;
@@ -3034,6 +3151,14 @@ int dav1d_decode_frame_init(Dav1dFrameContext *const f) {
                 goto error;
             }
         }
+        if (c->dirty_regions) {
+            dav1d_free(f->dirty.copied);
+            f->dirty.copied = dav1d_malloc(ALLOC_BLOCK, num_sb128 * 32 * 32);
+            if (!f->dirty.copied) {
+                f->lf.mask_sz = 0;
+                goto error;
+            }
+        }
         f->lf.mask_sz = num_sb128;
     }
 
@@ -3223,6 +3348,8 @@ int dav1d_decode_frame_main(Dav1dFrameContext *const f) {
     Dav1dTaskContext *const t = &c->tc[f - c->fc];
     t->f = f;
     t->frame_thread.pass = 0;
+    uint64_t start = f->stats.data ? dav1d_clock_ns() : 0;
+    if (t->perf.n) dav1d_perf_thread_start(&t->perf);
 
     for (int n = 0; n < f->sb128w * f->frame_hdr->tiling.rows; n++)
         reset_context(&f->a[n], IS_KEY_OR_INTRA(f->frame_hdr), 0);
@@ -3249,9 +3376,14 @@ int dav1d_decode_frame_main(Dav1dFrameContext *const f) {
                 dav1d_refmvs_save_tmvs(&f->c->refmvs_dsp, &t->rt,
                                        0, f->bw >> 1, t->by >> 1, by_end);
             }
+            dav1d_decode_stats_add(f, c->n_tc, DAV1D_DECODE_STAGE_RECONSTRUCTION, &start);
 
             // loopfilter + cdef + restoration
-            f->bd_fn.filter_sbrow(f, sby);
+            if (t->perf.n)
+                dav1d_perf_thread_sample(&t->perf, DAV1D_PERF_TASK_RECONSTRUCTION);
+            if (!c->entropy_only)
+                f->bd_fn.filter_sbrow(f, sby);
+            dav1d_decode_stats_add(f, c->n_tc, DAV1D_DECODE_STAGE_FILTER, &start);
         }
     }
 
@@ -3260,9 +3392,188 @@ error:
     return retval;
 }
 
+static int decode_stats_init(Dav1dContext *const c, Dav1dFrameContext *const f) {
+    const size_t time_sz = (c->n_tc + 1) * sizeof(*f->stats.time);
+    if (!f->stats.time) {
+        f->stats.time = dav1d_alloc_aligned(ALLOC_THREAD_CTX, time_sz, 64);
+        if (!f->stats.time) return DAV1D_ERR(ENOMEM);
+    }
+    memset(f->stats.time, 0, time_sz);
+
+    f->stats.ref = dav1d_ref_create_using_pool(c->decode_stats_pool,
+                                               sizeof(Dav1dDecodeStats));
+    if (!f->stats.ref) return DAV1D_ERR(ENOMEM);
+    Dav1dDecodeStats *const stats = f->stats.data = f->stats.ref->data;
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < f->n_tile_data; i++)
+        stats->compressed_size += f->tile[i].data.sz;
+    stats->n_tiles = f->frame_hdr->tiling.cols * f->frame_hdr->tiling.rows;
+    f->stats.start = dav1d_clock_ns();
+    return 0;
+}
+
+// Called once all tasks of the frame have completed, so that every thread's
+// row of stage times is final and visible to us.
+static void decode_stats_finish(Dav1dFrameContext *const f) {
+    const Dav1dContext *const c = f->c;
+    Dav1dDecodeStats *const stats = f->stats.data;
+
+    uint64_t stage_time[DAV1D_N_DECODE_STAGES] = { 0 };
+    uint64_t cpu_time = 0;
+    for (unsigned n = 0; n <= c->n_tc; n++)
+        for (int i = 0; i < DAV1D_N_DECODE_STAGES; i++)
+            stage_time[i] += f->stats.time[n].ns[i];
+    for (int i = 0; i < DAV1D_N_DECODE_STAGES; i++)
+        cpu_time += stage_time[i];
+    if (cpu_time)
+        for (int i = 0; i < DAV1D_N_DECODE_STAGES; i++)
+            stats->stage_fraction[i] = (float) ((double) stage_time[i] / cpu_time);
+    stats->cpu_time = cpu_time;
+    stats->wall_time = dav1d_clock_ns() - f->stats.start;
+
+    f->stats.data = NULL;
+    dav1d_ref_dec(&f->stats.ref);
+}
+
+static int block_info_init(Dav1dContext *const c, Dav1dFrameContext *const f) {
+    // f->bw * f->bh, which are not set yet
+    const size_t n_slots = (size_t) (((f->frame_hdr->width[0] + 7) >> 3) << 1) *
+                                    (((f->frame_hdr->height + 7) >> 3) << 1);
+    f->block_info.ref =
+        dav1d_ref_create_using_pool(c->block_info_pool, sizeof(Dav1dFrameBlockInfo) +
+                                                        n_slots * sizeof(Dav1dBlockInfo));
+    if (!f->block_info.ref) return DAV1D_ERR(ENOMEM);
+    Dav1dFrameBlockInfo *const info = f->block_info.data = f->block_info.ref->data;
+    info->blocks = (Dav1dBlockInfo *) &info[1];
+    info->n_blocks = 0;
+    // unused slots are recognized by their zero size
+    memset(info->blocks, 0, n_slots * sizeof(*info->blocks));
+    return 0;
+}
+
+// Called once all tasks of the frame have completed; moves the blocks to the
+// start of the array, keeping them in raster order.
+static void block_info_finish(Dav1dFrameContext *const f) {
+    Dav1dFrameBlockInfo *const info = f->block_info.data;
+    const size_t n_slots = (size_t) f->bw * f->bh;
+    size_t n = 0;
+    for (size_t i = 0; i < n_slots; i++)
+        if (info->blocks[i].w)
+            info->blocks[n++] = info->blocks[i];
+    info->n_blocks = n;
+
+    f->block_info.data = NULL;
+    dav1d_ref_dec(&f->block_info.ref);
+}
+
+static int dirty_map_init(Dav1dContext *const c, Dav1dFrameContext *const f) {
+    const Dav1dFrameHeader *const frame_hdr = f->frame_hdr;
+    const int w = (frame_hdr->width[1] + DAV1D_DIRTY_MAP_CELL_SIZE - 1) /
+                  DAV1D_DIRTY_MAP_CELL_SIZE;
+    const int h = (frame_hdr->height + DAV1D_DIRTY_MAP_CELL_SIZE - 1) /
+                  DAV1D_DIRTY_MAP_CELL_SIZE;
+    f->dirty.ref = dav1d_ref_create_using_pool(c->dirty_map_pool,
+                                               sizeof(Dav1dDirtyMap) + w * h);
+    if (!f->dirty.ref) return DAV1D_ERR(ENOMEM);
+    Dav1dDirtyMap *const map = f->dirty.data = f->dirty.ref->data;
+    map->dirty = (uint8_t *) &map[1];
+    map->w = w;
+    map->h = h;
+
+    // Blocks can only be copies of the previous shown picture if it is one
+    // of our references, and its output was not altered by film grain.
+    // Super-resolution and spatial layers resample it, so give up on those.
+    f->dirty.ref_mask = 0;
+    const Dav1dPicture *const prev = &c->dirty_prev;
+    if (!prev->data[0] || !IS_INTER_OR_SWITCH(frame_hdr) ||
+        prev->p.w != frame_hdr->width[1] || prev->p.h != frame_hdr->height ||
+        frame_hdr->width[0] != frame_hdr->width[1] || c->max_spatial_id ||
+        (c->apply_grain && (frame_hdr->film_grain.present ||
+                            prev->frame_hdr->film_grain.present)))
+    {
+        return 0;
+    }
+    for (int i = 0; i < 7; i++)
+        if (f->refp[i].p.data[0] == prev->data[0])
+            f->dirty.ref_mask |= 1 << i;
+    return 0;
+}
+
+// Called once all tasks of the frame have completed. Only the deblocking
+// filter can modify copied blocks: CDEF skips blocks without residual, and
+// loop restoration marks the whole picture dirty. Deblocking changes at most
+// 6 luma (or 2 chroma) pixels on either side of a filtered edge, so a cell is
+// unchanged if all 4x4 units within 8 pixels of it are copied and have no
+// filter level, which leaves no filtered edge close enough to reach it.
+static void dirty_map_finish(Dav1dFrameContext *const f, const int retval) {
+    Dav1dDirtyMap *const map = f->dirty.data;
+    const int has_deblock = f->c->inloop_filters & DAV1D_INLOOPFILTER_DEBLOCK &&
+                            (f->frame_hdr->loopfilter.level_y[0] ||
+                             f->frame_hdr->loopfilter.level_y[1]);
+    const int has_lr = f->c->inloop_filters & DAV1D_INLOOPFILTER_RESTORATION &&
+                       f->lf.restore_planes;
+    const int cell4 = DAV1D_DIRTY_MAP_CELL_SIZE >> 2;
+
+    if (retval || !f->dirty.ref_mask || has_lr) {
+        memset(map->dirty, 1, map->w * map->h);
+        map->n_dirty = map->w * map->h;
+    } else {
+        map->n_dirty = 0;
+        for (int cy = 0; cy < map->h; cy++) {
+            const int y_start = imax(cy * cell4 - 2, 0);
+            const int y_end = imin((cy + 1) * cell4 + 2, f->bh);
+            for (int cx = 0; cx < map->w; cx++) {
+                const int x_start = imax(cx * cell4 - 2, 0);
+                const int x_end = imin((cx + 1) * cell4 + 2, f->bw);
+                int dirty = 0;
+                for (int y = y_start; y < y_end && !dirty; y++) {
+                    const ptrdiff_t off = y * f->b4_stride;
+                    for (int x = x_start; x < x_end; x++) {
+                        const uint8_t *const lvl = f->lf.level[off + x];
+                        if (!f->dirty.copied[off + x] ||
+                            (has_deblock && (lvl[0] | lvl[1] | lvl[2] | lvl[3])))
+                        {
+                            dirty = 1;
+                            break;
+                        }
+                    }
+                }
+                map->dirty[cy * map->w + cx] = dirty;
+                map->n_dirty += dirty;
+            }
+        }
+    }
+
+    f->dirty.data = NULL;
+    dav1d_ref_dec(&f->dirty.ref);
+}
+
+// Called in output order for every shown picture, so that the next decoded
+// frame can tell which of its references is the previous shown picture.
+void dav1d_dirty_map_shown(Dav1dContext *const c, const Dav1dPicture *const p) {
+    if (c->dirty_prev.frame_hdr)
+        dav1d_picture_unref_internal(&c->dirty_prev);
+    dav1d_picture_ref(&c->dirty_prev, p);
+}
+
 void dav1d_decode_frame_exit(Dav1dFrameContext *const f, int retval) {
     const Dav1dContext *const c = f->c;
 
+    if (f->stats.data)
+        decode_stats_finish(f);
+    if (f->block_info.data)
+        block_info_finish(f);
+    if (f->dirty.data)
+        dirty_map_finish(f, retval);
+
+    // called with the task thread lock held if n_tc > 1
+    if (c->work_stats) {
+        Dav1dContext *const cw = (Dav1dContext *)c;
+        cw->work.blocks += atomic_exchange(&f->n_blocks, 0);
+        cw->work.coefs += atomic_exchange(&f->n_coefs, 0);
+        cw->work.tasks += atomic_exchange(&f->n_tasks, 0);
+    }
+
     if (f->sr_cur.p.data[0])
         atomic_init(&f->task_thread.error, 0);
 
@@ -3301,14 +3612,21 @@ void dav1d_decode_frame_exit(Dav1dFrameContext *const f, int retval) {
     for (int i = 0; i < f->n_tile_data; i++)
         dav1d_data_unref_internal(&f->tile[i].data);
     f->task_thread.retval = retval;
+    dav1d_trace3(frame_exit, c, (int) (f - c->fc), retval);
 }
 
 int dav1d_decode_frame(Dav1dFrameContext *const f) {
     assert(f->c->n_fc == 1);
     // if n_tc > 1 (but n_fc == 1), we could run init/exit in the task
     // threads also. Not sure it makes a measurable difference.
+    uint64_t start = f->stats.data ? dav1d_clock_ns() : 0;
+    Dav1dPerfThread *const perf = f->c->n_tc == 1 && f->c->tc[0].perf.n ?
+                                  &f->c->tc[0].perf : NULL;
+    if (perf) dav1d_perf_thread_start(perf);
     int res = dav1d_decode_frame_init(f);
     if (!res) res = dav1d_decode_frame_init_cdf(f);
+    dav1d_decode_stats_add(f, f->c->n_tc, DAV1D_DECODE_STAGE_INIT, &start);
+    if (perf) dav1d_perf_thread_sample(perf, DAV1D_PERF_TASK_INIT);
     // wait until all threads have completed
     if (!res) {
         if (f->c->n_tc > 1) {
@@ -3402,6 +3720,8 @@ int dav1d_submit_frame(Dav1dContext *const c) {
     c->frame_hdr = NULL;
     c->frame_hdr_ref = NULL;
     f->dsp = &c->dsp[f->seq_hdr->hbd];
+    dav1d_trace4(submit_frame, c, (int) (f - c->fc),
+                 f->frame_hdr->frame_type, f->frame_hdr->frame_offset);
 
     const int bpc = 8 + 2 * f->seq_hdr->hbd;
 
@@ -3538,6 +3858,19 @@ int dav1d_submit_frame(Dav1dContext *const c) {
     f->n_tile_data = c->n_tile_data;
     c->n_tile_data = 0;
 
+    if (c->decode_stats) {
+        res = decode_stats_init(c, f);
+        if (res < 0) goto error;
+    }
+    if (c->entropy_only) {
+        res = block_info_init(c, f);
+        if (res < 0) goto error;
+    }
+    if (c->dirty_regions) {
+        res = dirty_map_init(c, f);
+        if (res < 0) goto error;
+    }
+
     // allocate frame
     res = dav1d_thread_picture_alloc(c, f, bpc);
     if (res < 0) goto error;
@@ -3569,6 +3902,8 @@ int dav1d_submit_frame(Dav1dContext *const c) {
     } else {
         dav1d_thread_picture_ref(out_delayed, &f->sr_cur);
     }
+    if (c->dirty_regions && f->frame_hdr->show_frame)
+        dav1d_dirty_map_shown(c, &f->sr_cur.p);
 
     f->w4 = (f->frame_hdr->width[0] + 3) >> 2;
     f->h4 = (f->frame_hdr->height + 3) >> 2;
@@ -3582,7 +3917,12 @@ int dav1d_submit_frame(Dav1dContext *const c) {
     f->b4_stride = (f->bw + 31) & ~31;
     f->bitdepth_max = (1 << f->cur.p.bpc) - 1;
     atomic_init(&f->task_thread.error, 0);
-    const int uses_2pass = c->n_fc > 1;
+    atomic_init(&f->n_blocks, 0);
+    atomic_init(&f->n_coefs, 0);
+    atomic_init(&f->n_tasks, 0);
+    if (c->work_stats) c->work.frames++;
+    // with entropy_only, only the first of the two passes is scheduled
+    const int uses_2pass = c->n_fc > 1 && !c->entropy_only;
     const int cols = f->frame_hdr->tiling.cols;
     const int rows = f->frame_hdr->tiling.rows;
     atomic_store(&f->task_thread.task_counter,
@@ -3754,6 +4094,13 @@ error:
     dav1d_ref_dec(&f->mvs_ref);
     dav1d_ref_dec(&f->seq_hdr_ref);
     dav1d_ref_dec(&f->frame_hdr_ref);
+    dav1d_ref_dec(&f->stats.ref);
+    f->stats.data = NULL;
+    dav1d_ref_dec(&f->block_info.ref);
+    f->block_info.data = NULL;
+    dav1d_ref_dec(&f->dirty.ref);
+    f->dirty.data = NULL;
+    f->dirty.ref_mask = 0;
     dav1d_data_props_copy(&c->cached_error_props, &c->in.m);
 
     for (int i = 0; i < f->n_tile_data; i++)
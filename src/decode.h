@@ -31,5 +31,6 @@
 #include "src/internal.h"
 
 int dav1d_submit_frame(Dav1dContext *c);
+void dav1d_dirty_map_shown(Dav1dContext *c, const Dav1dPicture *p);
 
 #endif /* DAV1D_SRC_DECODE_H */
@@ -110,10 +110,13 @@ void bitfn(dav1d_prep_grain)(const Dav1dFilmGrainDSPContext *const dsp,
 
     // Generate grain LUTs as needed
     dsp->generate_grain_y(grain_lut[0], data HIGHBD_TAIL_SUFFIX); // always needed
-    if (data->num_uv_points[0] || data->chroma_scaling_from_luma)
+    // chroma grain can be signaled for pictures output without chroma planes
+    // (Dav1dSettings.luma_only)
+    const int has_chroma = in->p.layout != DAV1D_PIXEL_LAYOUT_I400;
+    if (has_chroma && (data->num_uv_points[0] || data->chroma_scaling_from_luma))
         dsp->generate_grain_uv[in->p.layout - 1](grain_lut[1], grain_lut[0],
                                                  data, 0 HIGHBD_TAIL_SUFFIX);
-    if (data->num_uv_points[1] || data->chroma_scaling_from_luma)
+    if (has_chroma && (data->num_uv_points[1] || data->chroma_scaling_from_luma))
         dsp->generate_grain_uv[in->p.layout - 1](grain_lut[2], grain_lut[0],
                                                  data, 1 HIGHBD_TAIL_SUFFIX);
 
@@ -184,8 +187,9 @@ void bitfn(dav1d_apply_grain_row)(const Dav1dFilmGrainDSPContext *const dsp,
                          out->p.w, scaling[0], grain_lut[0], bh, row HIGHBD_TAIL_SUFFIX);
     }
 
-    if (!data->num_uv_points[0] && !data->num_uv_points[1] &&
-        !data->chroma_scaling_from_luma)
+    if (in->p.layout == DAV1D_PIXEL_LAYOUT_I400 ||
+        (!data->num_uv_points[0] && !data->num_uv_points[1] &&
+         !data->chroma_scaling_from_luma))
     {
         return;
     }
@@ -28,6 +28,7 @@
 #ifndef DAV1D_SRC_GETBITS_H
 #define DAV1D_SRC_GETBITS_H
 
+#include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -0,0 +1,539 @@
+/*
+ * Copyright © 2024, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "config.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "dav1d/dav1d.h"
+
+#include "src/filmgrain.h"
+#include "src/getbits.h"
+#include "src/gop.h"
+#include "src/internal.h"
+#include "src/levels.h"
+#include "src/log.h"
+#include "src/mem.h"
+#include "src/thread.h"
+
+// pictures a segment may queue ahead of the one being output, in units of
+// the sub-decoder frame delay; this bounds the memory of each segment to a
+// few times that of its sub-decoder, at the cost of parallelism for GOPs
+// much longer than that
+#define QUEUED_PICTURES_PER_FRAME_DELAY 4
+
+typedef struct GopOutput {
+    Dav1dPicture p;
+    int res; // < 0 for a decoding error reported at this position
+    enum Dav1dEventFlags event_flags;
+} GopOutput;
+
+typedef struct GopSegment {
+    int active;
+    int input_done, decode_done, abort;
+    int drained; // all input so far was decoded and output
+    // events of the sequence header the segment starts with, relative to
+    // the previous segment; replaces those of the first picture, which the
+    // flushed sub-decoder always reports as a new sequence
+    enum Dav1dEventFlags seq_events;
+    int first_picture_done;
+    // events reported by the sub-decoder, until the next picture is queued
+    enum Dav1dEventFlags event_flags;
+    // input, appended by the caller and consumed by the driver thread
+    Dav1dData *data;
+    int n_data, next_data, data_sz;
+    // output, appended by the driver thread and consumed by the caller
+    GopOutput *out;
+    int n_out, next_out, out_sz;
+} GopSegment;
+
+typedef struct GopSlot {
+    struct Dav1dGopContext *g;
+    Dav1dContext *c;
+    pthread_t thread;
+    int inited;
+} GopSlot;
+
+struct Dav1dGopContext {
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // signaled on any change of the segments below
+    int die;
+    // segment i is decoded by slot i; segments are in stream order in
+    // seg[head], seg[head + 1], ... (modulo n_slots)
+    unsigned n_slots, head, n_seg;
+    GopSlot *slot;
+    GopSegment *seg;
+    int max_queued; // see QUEUED_PICTURES_PER_FRAME_DELAY
+    // applies film grain for dav1d_apply_grain(), as the sub-decoders are
+    // in use by the driver threads
+    Dav1dContext *grain;
+    int input_blocked; // the last dav1d_gop_send_data() returned EAGAIN
+    int drain; // the caller waits for all pictures of the input so far
+    // last sequence header OBU seen, prepended to segments lacking one
+    Dav1dData seq_hdr;
+    Dav1dSequenceHeader parsed_seq_hdr;
+    // last HDR metadata OBUs of the current sequence, indexed by
+    // OBU_META_HDR_CLL - 1 and OBU_META_HDR_MDCV - 1; like the sequence
+    // header, the sub-decoders lose them when flushed between segments
+    Dav1dData hdr_meta[2];
+};
+
+// Information about a temporal unit, see scan_temporal_unit()
+typedef struct TemporalUnitInfo {
+    int has_seq_hdr;
+    unsigned has_hdr_meta; // mask of 1 << (OBU_META_HDR_* - 1)
+    // events of its sequence header, relative to the previous one
+    enum Dav1dEventFlags seq_events;
+} TemporalUnitInfo;
+
+static int copy_obu(Dav1dData *const dst, const uint8_t *const obu,
+                    const size_t sz)
+{
+    Dav1dData copy = { 0 };
+    uint8_t *const ptr = dav1d_data_create_internal(&copy, sz);
+    if (!ptr) return -1;
+    memcpy(ptr, obu, sz);
+    dav1d_data_unref_internal(dst);
+    *dst = copy;
+    return 0;
+}
+
+// Scans the OBUs of a temporal unit for a sequence header and HDR metadata,
+// which are kept, and returns whether the first frame is a shown key frame,
+// i.e. starts a closed GOP.
+static int scan_temporal_unit(Dav1dGopContext *const g, const Dav1dData *const in,
+                              TemporalUnitInfo *const info)
+{
+    GetBits gb;
+    dav1d_init_get_bits(&gb, in->data, in->sz);
+    memset(info, 0, sizeof(*info));
+
+    do {
+        const uint8_t *const obu_start = gb.ptr;
+        dav1d_get_bit(&gb); // obu_forbidden_bit
+        const enum Dav1dObuType type = dav1d_get_bits(&gb, 4);
+        const int has_extension = dav1d_get_bit(&gb);
+        const int has_length_field = dav1d_get_bit(&gb);
+        dav1d_get_bits(&gb, 1 + 8 * has_extension); // ignore
+
+        const uint8_t *obu_end = gb.ptr_end;
+        if (has_length_field) {
+            const size_t len = dav1d_get_uleb128(&gb);
+            if (len > (size_t)(obu_end - gb.ptr)) return 0;
+            obu_end = gb.ptr + len;
+        }
+        if (gb.error) return 0;
+
+        if (type == DAV1D_OBU_SEQ_HDR) {
+            const size_t sz = obu_end - obu_start;
+            info->has_seq_hdr = 1;
+            if (sz != g->seq_hdr.sz || memcmp(obu_start, g->seq_hdr.data, sz)) {
+                Dav1dSequenceHeader seq_hdr;
+                if (dav1d_parse_sequence_header(&seq_hdr, obu_start, sz) < 0)
+                    return 0;
+                // same as in dav1d_parse_obus()
+                if (!g->seq_hdr.data ||
+                    memcmp(&seq_hdr, &g->parsed_seq_hdr,
+                           offsetof(Dav1dSequenceHeader, operating_parameter_info)))
+                {
+                    info->seq_events |= DAV1D_EVENT_FLAG_NEW_SEQUENCE;
+                    dav1d_data_unref_internal(&g->hdr_meta[0]);
+                    dav1d_data_unref_internal(&g->hdr_meta[1]);
+                } else if (memcmp(seq_hdr.operating_parameter_info,
+                                  g->parsed_seq_hdr.operating_parameter_info,
+                                  sizeof(seq_hdr.operating_parameter_info)))
+                {
+                    info->seq_events |= DAV1D_EVENT_FLAG_NEW_OP_PARAMS_INFO;
+                }
+                if (copy_obu(&g->seq_hdr, obu_start, sz)) return 0;
+                g->parsed_seq_hdr = seq_hdr;
+            }
+        } else if (type == DAV1D_OBU_METADATA) {
+            const enum ObuMetaType meta_type = dav1d_get_uleb128(&gb);
+            if (!gb.error && (meta_type == OBU_META_HDR_CLL ||
+                              meta_type == OBU_META_HDR_MDCV))
+            {
+                info->has_hdr_meta |= 1U << (meta_type - 1);
+                copy_obu(&g->hdr_meta[meta_type - 1], obu_start, obu_end - obu_start);
+            }
+        } else if (type == DAV1D_OBU_FRAME_HDR || type == DAV1D_OBU_FRAME) {
+            if (g->parsed_seq_hdr.reduced_still_picture_header) return 1;
+            if (obu_end == gb.ptr) return 0;
+            const int show_existing_frame = dav1d_get_bit(&gb);
+            const enum Dav1dFrameType frame_type = dav1d_get_bits(&gb, 2);
+            const int show_frame = dav1d_get_bit(&gb);
+            return !gb.error && !show_existing_frame &&
+                   frame_type == DAV1D_FRAME_TYPE_KEY && show_frame;
+        }
+
+        gb.ptr = obu_end;
+    } while (gb.ptr < gb.ptr_end);
+
+    return 0;
+}
+
+static int grow(void **const ptr, int *const sz, const int n, const size_t el_sz) {
+    if (n < *sz) return 0;
+    const int new_sz = *sz ? *sz * 2 : 16;
+    void *const new_ptr = dav1d_realloc(ALLOC_COMMON_CTX, *ptr, new_sz * el_sz);
+    if (!new_ptr) return DAV1D_ERR(ENOMEM);
+    *ptr = new_ptr;
+    *sz = new_sz;
+    return 0;
+}
+
+// Queues a decoded picture, or an error, for output; must be called with
+// g->lock held. Unless the segment is the one being output, this waits
+// while too many pictures are queued already.
+static void queue_output(Dav1dGopContext *const g, GopSegment *const seg,
+                         Dav1dPicture *const p, const int res,
+                         const enum Dav1dEventFlags event_flags)
+{
+    while (!seg->abort && seg != &g->seg[g->head] &&
+           seg->n_out - seg->next_out >= g->max_queued)
+    {
+        pthread_cond_wait(&g->cond, &g->lock);
+    }
+    if (seg->abort || grow((void **) &seg->out, &seg->out_sz,
+                           seg->n_out, sizeof(*seg->out)) < 0)
+    {
+        if (p) dav1d_picture_unref_internal(p);
+        return;
+    }
+    GopOutput *const out = &seg->out[seg->n_out++];
+    memset(out, 0, sizeof(*out));
+    out->res = res;
+    out->event_flags = event_flags;
+    if (p) {
+        dav1d_picture_move_ref(&out->p, p);
+        if (!seg->first_picture_done) {
+            out->event_flags &= ~(DAV1D_EVENT_FLAG_NEW_SEQUENCE |
+                                  DAV1D_EVENT_FLAG_NEW_OP_PARAMS_INFO);
+            out->event_flags |= seg->seq_events;
+            seg->first_picture_done = 1;
+        }
+    }
+    pthread_cond_broadcast(&g->cond);
+}
+
+// Outputs the picture the sub-decoder has ready, if any, or if drain is set,
+// all pictures of the data sent so far; must be called with g->lock held,
+// which is released while decoding. Like in the API usage loop, a single
+// dav1d_get_picture() call follows each dav1d_send_data() call, since any
+// further call would drain the frame threading pipeline.
+static void output_pictures(Dav1dGopContext *const g, Dav1dContext *const c,
+                            GopSegment *const seg, const int drain)
+{
+    for (int n = 0;; n++) {
+        Dav1dPicture p = { 0 };
+        pthread_mutex_unlock(&g->lock);
+        const int res = dav1d_get_picture(c, &p);
+        enum Dav1dEventFlags event_flags = 0;
+        dav1d_get_event_flags(c, &event_flags);
+        pthread_mutex_lock(&g->lock);
+        seg->event_flags |= event_flags;
+        if (res == DAV1D_ERR(EAGAIN)) {
+            // dav1d_get_picture() called again right after returning
+            // EAGAIN drains the decoder
+            if (!drain || n) return;
+            continue;
+        }
+        queue_output(g, seg, res < 0 ? NULL : &p, imin(res, 0), seg->event_flags);
+        seg->event_flags = 0;
+        if (!drain || (res < 0 && res != DAV1D_ERR(EINVAL))) return;
+    }
+}
+
+static void *gop_slot_task(void *const data) {
+    GopSlot *const slot = data;
+    Dav1dGopContext *const g = slot->g;
+    Dav1dContext *const c = slot->c;
+    GopSegment *const seg = &g->seg[slot - g->slot];
+
+    dav1d_set_thread_name("dav1d-gop");
+    pthread_mutex_lock(&g->lock);
+    for (;;) {
+        if (g->die) break;
+        if (!seg->active || seg->decode_done) {
+            pthread_cond_wait(&g->cond, &g->lock);
+        } else if (!seg->abort && seg->next_data < seg->n_data) {
+            Dav1dData in = seg->data[seg->next_data];
+            memset(&seg->data[seg->next_data++], 0, sizeof(in));
+            while (in.sz > 0 && !seg->abort) {
+                pthread_mutex_unlock(&g->lock);
+                const int res = dav1d_send_data(c, &in);
+                pthread_mutex_lock(&g->lock);
+                if (res < 0 && res != DAV1D_ERR(EAGAIN)) {
+                    queue_output(g, seg, NULL, res, 0);
+                    break;
+                }
+                output_pictures(g, c, seg, 0);
+            }
+            dav1d_data_unref_internal(&in);
+        } else if (g->drain && !seg->abort && !seg->input_done && !seg->drained) {
+            output_pictures(g, c, seg, 1);
+            seg->drained = 1;
+            pthread_cond_broadcast(&g->cond);
+        } else if (seg->abort || seg->input_done) {
+            // drain, and get ready for the next segment
+            if (!seg->abort) output_pictures(g, c, seg, 1);
+            pthread_mutex_unlock(&g->lock);
+            dav1d_flush(c);
+            pthread_mutex_lock(&g->lock);
+            seg->decode_done = 1;
+            pthread_cond_broadcast(&g->cond);
+        } else {
+            pthread_cond_wait(&g->cond, &g->lock);
+        }
+    }
+    pthread_mutex_unlock(&g->lock);
+
+    return NULL;
+}
+
+static void reset_segment(GopSegment *const seg) {
+    for (int i = seg->next_data; i < seg->n_data; i++)
+        dav1d_data_unref_internal(&seg->data[i]);
+    for (int i = seg->next_out; i < seg->n_out; i++)
+        dav1d_picture_unref_internal(&seg->out[i].p);
+    seg->active = seg->input_done = seg->decode_done = seg->abort = 0;
+    seg->drained = 0;
+    seg->seq_events = seg->event_flags = 0;
+    seg->first_picture_done = 0;
+    seg->n_data = seg->next_data = 0;
+    seg->n_out = seg->next_out = 0;
+}
+
+COLD int dav1d_gop_open(Dav1dContext *const c, const Dav1dSettings *const s,
+                        const unsigned n_threads)
+{
+    Dav1dGopContext *const g = dav1d_malloc(ALLOC_COMMON_CTX, sizeof(*g));
+    if (!g) return DAV1D_ERR(ENOMEM);
+    memset(g, 0, sizeof(*g));
+    if (pthread_mutex_init(&g->lock, NULL)) {
+        dav1d_free(g);
+        return DAV1D_ERR(ENOMEM);
+    }
+    if (pthread_cond_init(&g->cond, NULL)) {
+        pthread_mutex_destroy(&g->lock);
+        dav1d_free(g);
+        return DAV1D_ERR(ENOMEM);
+    }
+    c->gop = g;
+
+    g->n_slots = s->parallel_gops;
+    g->slot = dav1d_malloc(ALLOC_COMMON_CTX, sizeof(*g->slot) * g->n_slots);
+    g->seg = dav1d_malloc(ALLOC_COMMON_CTX, sizeof(*g->seg) * g->n_slots);
+    if (!g->slot || !g->seg) return DAV1D_ERR(ENOMEM);
+    memset(g->slot, 0, sizeof(*g->slot) * g->n_slots);
+    memset(g->seg, 0, sizeof(*g->seg) * g->n_slots);
+
+    // the thread budget is split evenly between the sub-decoders
+    Dav1dSettings sub = *s;
+    sub.parallel_gops = 0;
+    sub.n_threads = imax(n_threads / g->n_slots, 1);
+    for (unsigned n = 0; n < g->n_slots; n++) {
+        GopSlot *const slot = &g->slot[n];
+        int res = dav1d_open(&slot->c, &sub);
+        if (res < 0) return res;
+        slot->g = g;
+        if (pthread_create(&slot->thread, NULL, gop_slot_task, slot))
+            return DAV1D_ERR(ENOMEM);
+        slot->inited = 1;
+    }
+    g->max_queued = QUEUED_PICTURES_PER_FRAME_DELAY * g->slot[0].c->n_fc;
+
+    // film grain is applied synchronously on the caller's thread
+    sub.n_threads = 1;
+    sub.perf_counters = sub.stall_stats = 0;
+    const int res = dav1d_open(&g->grain, &sub);
+    if (res < 0) return res;
+#if CONFIG_8BPC
+    dav1d_film_grain_dsp_init_8bpc(&g->grain->dsp[0].fg);
+#endif
+#if CONFIG_16BPC
+    dav1d_film_grain_dsp_init_16bpc(&g->grain->dsp[1].fg);
+    dav1d_film_grain_dsp_init_16bpc(&g->grain->dsp[2].fg);
+#endif
+
+    return 0;
+}
+
+COLD void dav1d_gop_close(Dav1dContext *const c) {
+    Dav1dGopContext *const g = c->gop;
+
+    if (g->slot) {
+        pthread_mutex_lock(&g->lock);
+        g->die = 1;
+        pthread_cond_broadcast(&g->cond);
+        pthread_mutex_unlock(&g->lock);
+        for (unsigned n = 0; n < g->n_slots; n++) {
+            GopSlot *const slot = &g->slot[n];
+            if (slot->inited) pthread_join(slot->thread, NULL);
+            dav1d_close(&slot->c);
+        }
+    }
+    if (g->seg) {
+        for (unsigned n = 0; n < g->n_slots; n++) {
+            reset_segment(&g->seg[n]);
+            dav1d_free(g->seg[n].data);
+            dav1d_free(g->seg[n].out);
+        }
+    }
+    if (g->grain) dav1d_close(&g->grain);
+    dav1d_data_unref_internal(&g->seq_hdr);
+    dav1d_data_unref_internal(&g->hdr_meta[0]);
+    dav1d_data_unref_internal(&g->hdr_meta[1]);
+    dav1d_free(g->slot);
+    dav1d_free(g->seg);
+    pthread_cond_destroy(&g->cond);
+    pthread_mutex_destroy(&g->lock);
+    dav1d_free(g);
+    c->gop = NULL;
+}
+
+int dav1d_gop_send_data(Dav1dContext *const c, Dav1dData *const in) {
+    Dav1dGopContext *const g = c->gop;
+    if (!in->data) return 0;
+
+    TemporalUnitInfo info;
+    const int new_segment = scan_temporal_unit(g, in, &info);
+
+    pthread_mutex_lock(&g->lock);
+    GopSegment *seg = g->n_seg ?
+        &g->seg[(g->head + g->n_seg - 1) % g->n_slots] : NULL;
+    if (!seg || seg->input_done || new_segment) {
+        if (seg) seg->input_done = 1;
+        if (g->n_seg == g->n_slots) {
+            g->input_blocked = 1;
+            pthread_cond_broadcast(&g->cond);
+            pthread_mutex_unlock(&g->lock);
+            return DAV1D_ERR(EAGAIN);
+        }
+        seg = &g->seg[(g->head + g->n_seg++) % g->n_slots];
+        seg->active = 1;
+        seg->seq_events = info.seq_events;
+        // the sequence header and HDR metadata in effect, unless the
+        // temporal unit has its own
+        const Dav1dData *carry[3] = { NULL };
+        int n_carry = 0;
+        if (!info.has_seq_hdr && g->seq_hdr.data)
+            carry[n_carry++] = &g->seq_hdr;
+        for (int i = 0; i < 2; i++)
+            if (!(info.has_hdr_meta & (1U << i)) && g->hdr_meta[i].data)
+                carry[n_carry++] = &g->hdr_meta[i];
+        for (int i = 0; i < n_carry; i++) {
+            if (grow((void **) &seg->data, &seg->data_sz, seg->n_data,
+                     sizeof(*seg->data)) < 0)
+            {
+                goto error;
+            }
+            Dav1dData *const data = &seg->data[seg->n_data++];
+            memset(data, 0, sizeof(*data));
+            dav1d_data_ref(data, carry[i]);
+        }
+    }
+    if (grow((void **) &seg->data, &seg->data_sz, seg->n_data, sizeof(*seg->data)) < 0)
+        goto error;
+    seg->data[seg->n_data++] = *in;
+    memset(in, 0, sizeof(*in));
+    seg->drained = 0;
+    g->input_blocked = g->drain = 0;
+    pthread_cond_broadcast(&g->cond);
+    pthread_mutex_unlock(&g->lock);
+    return 0;
+
+error:
+    pthread_mutex_unlock(&g->lock);
+    return DAV1D_ERR(ENOMEM);
+}
+
+int dav1d_gop_get_picture(Dav1dContext *const c, Dav1dPicture *const out,
+                          const int drain)
+{
+    Dav1dGopContext *const g = c->gop;
+
+    pthread_mutex_lock(&g->lock);
+    int res = DAV1D_ERR(EAGAIN);
+    if (drain && !g->drain) {
+        g->drain = 1;
+        pthread_cond_broadcast(&g->cond);
+    }
+    while (g->n_seg) {
+        GopSegment *const seg = &g->seg[g->head];
+        if (seg->next_out < seg->n_out) {
+            GopOutput *const o = &seg->out[seg->next_out++];
+            c->event_flags |= o->event_flags;
+            if ((res = o->res) >= 0)
+                dav1d_picture_move_ref(out, &o->p);
+            pthread_cond_broadcast(&g->cond);
+            break;
+        }
+        if (seg->decode_done) {
+            reset_segment(seg);
+            g->head = (g->head + 1) % g->n_slots;
+            g->n_seg--;
+            pthread_cond_broadcast(&g->cond);
+            continue;
+        }
+        // wait for output if no more input can be taken, or if draining,
+        // until the last segment has caught up with the input
+        if (drain ? g->n_seg == 1 && seg->drained : !g->input_blocked) break;
+        pthread_cond_wait(&g->cond, &g->lock);
+    }
+    pthread_mutex_unlock(&g->lock);
+
+    return res;
+}
+
+void dav1d_gop_flush(Dav1dContext *const c) {
+    Dav1dGopContext *const g = c->gop;
+
+    pthread_mutex_lock(&g->lock);
+    for (unsigned n = 0; n < g->n_seg; n++) {
+        GopSegment *const seg = &g->seg[(g->head + n) % g->n_slots];
+        seg->abort = 1;
+    }
+    pthread_cond_broadcast(&g->cond);
+    for (unsigned n = 0; n < g->n_seg; n++) {
+        GopSegment *const seg = &g->seg[(g->head + n) % g->n_slots];
+        while (!seg->decode_done)
+            pthread_cond_wait(&g->cond, &g->lock);
+        reset_segment(seg);
+    }
+    g->head = g->n_seg = 0;
+    g->input_blocked = g->drain = 0;
+    pthread_mutex_unlock(&g->lock);
+}
+
+int dav1d_gop_apply_grain(Dav1dContext *const c, Dav1dPicture *const out,
+                          const Dav1dPicture *const in)
+{
+    return dav1d_apply_grain(c->gop->grain, out, in);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2024, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef DAV1D_SRC_GOP_H
+#define DAV1D_SRC_GOP_H
+
+#include "dav1d/dav1d.h"
+
+/* GOP-parallel decoding: the stream is split into closed GOPs, starting at
+ * each shown key frame, which are decoded concurrently by sub-decoders, each
+ * driven by its own thread. Pictures are returned in stream order. This
+ * replaces the decoding state of the context passed to these functions. */
+int dav1d_gop_open(Dav1dContext *c, const Dav1dSettings *s, unsigned n_threads);
+void dav1d_gop_close(Dav1dContext *c);
+
+int dav1d_gop_send_data(Dav1dContext *c, Dav1dData *in);
+int dav1d_gop_get_picture(Dav1dContext *c, Dav1dPicture *out, int drain);
+void dav1d_gop_flush(Dav1dContext *c);
+int dav1d_gop_apply_grain(Dav1dContext *c, Dav1dPicture *out,
+                          const Dav1dPicture *in);
+
+#endif /* DAV1D_SRC_GOP_H */
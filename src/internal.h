@@ -36,11 +36,13 @@ typedef struct Dav1dFrameContext Dav1dFrameContext;
 typedef struct Dav1dTileState Dav1dTileState;
 typedef struct Dav1dTaskContext Dav1dTaskContext;
 typedef struct Dav1dTask Dav1dTask;
+typedef struct Dav1dGopContext Dav1dGopContext;
 
 #include "common/attributes.h"
 
 #include "src/cdef.h"
 #include "src/cdf.h"
+#include "src/cpu.h"
 #include "src/data.h"
 #include "src/env.h"
 #include "src/filmgrain.h"
@@ -54,6 +56,7 @@ typedef struct Dav1dTask Dav1dTask;
 #include "src/mc.h"
 #include "src/msac.h"
 #include "src/pal.h"
+#include "src/perf_counters.h"
 #include "src/picture.h"
 #include "src/recon.h"
 #include "src/refmvs.h"
@@ -133,14 +136,21 @@ struct Dav1dContext {
     struct TaskThreadData {
         pthread_mutex_t lock;
         pthread_cond_t cond;
-        atomic_uint first;
         unsigned cur;
+        // workers with an index >= n_active are parked on parked_cond by
+        // energy saving mode, away from cond so they don't absorb the
+        // signals meant for the running ones
+        unsigned n_active;
+        pthread_cond_t parked_cond;
+        // The atomics below are accessed locklessly by all workers, so each
+        // is kept on its own cache line, away from the lock and each other.
+        ALIGN(atomic_uint first, 64);
         // This is used for delayed reset of the task cur pointer when
         // such operation is needed but the thread doesn't enter a critical
         // section (typically when executing the next sbrow task locklessly).
         // See src/thread_task.c:reset_task_cur().
-        atomic_uint reset_task_cur;
-        atomic_int cond_signaled;
+        ALIGN(atomic_uint reset_task_cur, 64);
+        ALIGN(atomic_int cond_signaled, 64);
         struct {
             int exec, finished;
             pthread_cond_t cond;
@@ -189,16 +199,64 @@ struct Dav1dContext {
     int output_invisible_frames;
     enum Dav1dInloopFilterType inloop_filters;
     enum Dav1dDecodeFrameType decode_frame_type;
+    int decode_stats;
+    int perf_counters;
+    int stall_stats;
+    int track_idle; // stall_stats or energy saving, which needs the busy time
+    int resync;
+    unsigned frame_block_limit;
+    int luma_only;
+    int entropy_only;
+    int dirty_regions;
+    int work_stats;
+    // count blocks and coefficients, for work_stats, frame_block_limit and
+    // the block info of entropy_only
+    int count_work;
+    Dav1dPicture dirty_prev; // previous shown picture, with dirty_regions
+    int n_worker_cpus; // CPUs the worker threads are confined to, 0 = unconfined
+#ifdef HAVE_CPU_TOPOLOGY
+    cpu_set_t worker_cpus;
+    // on hybrid CPUs, the fast ones to which tile decoding is steered
+    int n_fast_cpus;
+    cpu_set_t fast_cpus;
+#endif
     int drain;
     enum PictureFlags frame_flags;
     enum Dav1dEventFlags event_flags;
     Dav1dDataProps cached_error_props;
     int cached_error;
 
+    // energy saving mode, only used if energy_saving is set and n_tc > 1;
+    // updated by the thread outputting pictures
+    struct {
+        int enabled;
+        unsigned fps_num, fps_den; // target frame rate, 0/0 = from the stream
+        uint64_t frames;
+        uint64_t first, last; // output time of the first and last picture
+        uint64_t active_time;
+        // measurement window of the controller
+        uint64_t window_start, window_busy;
+        unsigned window_frames;
+    } energy;
+
+    // decoding work, see dav1d_get_work_stats(); frames are counted on
+    // submission, the rest is added by dav1d_decode_frame_exit(), which
+    // holds task_thread.lock if n_tc > 1
+    struct {
+        uint64_t frames, blocks, coefs, tasks;
+    } work;
+
+    // GOP-parallel decoding: if set, this context only dispatches the
+    // stream to sub-decoders, see src/gop.c
+    Dav1dGopContext *gop;
+
     Dav1dLogger logger;
 
     Dav1dMemPool *picture_pool;
     Dav1dMemPool *pic_ctx_pool;
+    Dav1dMemPool *decode_stats_pool;
+    Dav1dMemPool *block_info_pool;
+    Dav1dMemPool *dirty_map_pool;
 };
 
 struct Dav1dTask {
@@ -275,8 +333,6 @@ struct Dav1dFrameContext {
 
     struct {
         int next_tile_row[2 /* 0: reconstruction, 1: entropy */];
-        atomic_int entropy_progress;
-        atomic_int deblock_progress; // in sby units
         atomic_uint *frame_progress, *copy_lpf_progress;
         // indexed using t->by * f->b4_stride + t->bx
         Av1Block *b;
@@ -290,6 +346,10 @@ struct Dav1dFrameContext {
         int cbi_sz, pal_sz, pal_idx_sz, cf_sz;
         // start offsets per tile
         unsigned *tile_start_off;
+        // written by different workers for every sbrow, and polled by the
+        // others, so each gets its own cache line
+        ALIGN(atomic_int entropy_progress, 64);
+        ALIGN(atomic_int deblock_progress, 64); // in sby units
     } frame_thread;
 
     // loopfilter
@@ -298,9 +358,11 @@ struct Dav1dFrameContext {
         Av1Filter *mask;
         Av1Restoration *lr_mask;
         int mask_sz /* w*h */, lr_mask_sz;
-        int cdef_buf_plane_sz[2]; /* stride*sbh*4 */
-        int cdef_buf_sbh;
-        int lr_buf_plane_sz[2]; /* (stride*sbh*4) << sb128 if n_tc > 1, else stride*4 */
+        int cdef_buf_plane_sz[2]; /* stride*line_buf_sbh*4 */
+        // number of sbrows held by the cdef/lr line buffers: a ring sized by
+        // the sbrows that can be post-filtered concurrently if n_tc > 1, else 1
+        int line_buf_sbh;
+        int lr_buf_plane_sz[2]; /* stride*((line_buf_sbh*4 << sb128) + 4) if n_tc > 1, else stride*12 */
         int re_sz /* h */;
         ALIGN(Av1FilterLUT lim_lut, 16);
         ALIGN(uint8_t lvl[8 /* seg_id */][4 /* dir */][8 /* ref */][2 /* is_gmv */], 16);
@@ -325,20 +387,24 @@ struct Dav1dFrameContext {
         struct TaskThreadData *ttd;
         struct Dav1dTask *tasks, *tile_tasks[2], init_task;
         int num_tasks, num_tile_tasks;
-        atomic_int init_done;
-        atomic_int done[2];
         int retval;
         int update_set; // whether we need to update CDF reference
-        atomic_int error;
-        atomic_int task_counter;
-        struct Dav1dTask *task_head, *task_tail;
+        // read by every task but only written a few times per frame
+        ALIGN(atomic_int error, 64);
+        atomic_int init_done;
+        atomic_int done[2];
+        // updated by every task
+        ALIGN(atomic_int task_counter, 64);
+        // protected by ttd->lock
+        ALIGN(struct Dav1dTask *task_head, 64);
+        struct Dav1dTask *task_tail;
         // Points to the task directly before the cur pointer in the queue.
         // This cur pointer is theoretical here, we actually keep track of the
         // "prev_t" variable. This is needed to not loose the tasks in
         // [head;cur-1] when picking one for execution.
         struct Dav1dTask *task_cur_prev;
         struct { // async task insertion
-            atomic_int merge;
+            ALIGN(atomic_int merge, 64);
             pthread_mutex_t lock;
             Dav1dTask *head, *tail;
         } pending_tasks;
@@ -349,6 +415,42 @@ struct Dav1dFrameContext {
         int (*lowest_pixel_mem)[7][2];
         int lowest_pixel_mem_sz;
     } tile_thread;
+
+    // decoding cost accounting, only used if c->decode_stats is set
+    struct {
+        Dav1dRef *ref;
+        Dav1dDecodeStats *data; // NULL if not accounting
+        uint64_t start; // submission time, in ns
+        // [n_tc + 1]; one row per worker thread plus one for the calling
+        // thread, so that each thread only ever writes to its own row
+        struct FrameStageTime {
+            ALIGN(uint64_t ns[DAV1D_N_DECODE_STAGES], 64);
+        } *time;
+    } stats;
+
+    // coded blocks, only used if c->entropy_only is set; until the frame
+    // is done, blocks[] has one slot per 4x4 unit, see add_block_info()
+    struct {
+        Dav1dRef *ref;
+        Dav1dFrameBlockInfo *data; // NULL if not recording
+    } block_info;
+
+    // changes since the previous shown picture, only used if
+    // c->dirty_regions is set
+    struct {
+        Dav1dRef *ref;
+        Dav1dDirtyMap *data;
+        // bit i is set if refp[i] is the previous shown picture; 0 if no
+        // block can be a copy of it, making the whole picture dirty
+        uint8_t ref_mask;
+        // [b4_stride * sb128h * 32]; 1 for 4x4 units copied unmodified from
+        // the previous shown picture (before in-loop filtering)
+        uint8_t *copied;
+    } dirty;
+
+    // work accounting, added to c->work when the frame completes
+    atomic_uint n_blocks, n_coefs, n_tasks;
+    atomic_int block_limit_hit; // cleared by dav1d_get_event_flags()
 };
 
 struct Dav1dTileState {
@@ -360,8 +462,12 @@ struct Dav1dTileState {
         int col, row; // in tile units
     } tiling;
 
-    // in sby units, TILE_ERROR after a decoding error
-    atomic_int progress[2 /* 0: reconstruction, 1: entropy */];
+    // in sby units, TILE_ERROR after a decoding error; both passes can run
+    // concurrently in different threads, so they don't share a cache line
+    // with each other nor with the symbol decoder state above
+    struct {
+        ALIGN(atomic_int sby, 64);
+    } progress[2 /* 0: reconstruction, 1: entropy */];
     struct {
         uint8_t *pal_idx;
         int16_t *cbi;
@@ -393,6 +499,7 @@ struct Dav1dTaskContext {
     int bx, by;
     BlockContext l, *a;
     refmvs_tile rt;
+    unsigned n_blocks, n_coefs; // in the current sbrow, for work accounting
     ALIGN(union, 64) {
         int16_t cf_8bpc [32 * 32];
         int32_t cf_16bpc[32 * 32];
@@ -465,7 +572,20 @@ struct Dav1dTaskContext {
         struct FrameTileThreadData *fttd;
         int flushed;
         int die;
+        // idle time accounting, only used if c->track_idle is set;
+        // protected by ttd->lock
+        struct {
+            uint64_t start; // thread start time
+            uint64_t wait_start; // start of the current idle period, 0 if busy
+            enum Dav1dStallReason reason; // of the current idle period
+            uint64_t time[DAV1D_N_STALL_REASONS];
+            uint64_t count[DAV1D_N_STALL_REASONS];
+        } stall;
     } task_thread;
+
+    // hardware counters of the thread running this context, only opened if
+    // c->perf_counters is set
+    Dav1dPerfThread perf;
 };
 
 #endif /* DAV1D_SRC_INTERNAL_H */
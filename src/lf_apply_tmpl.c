@@ -27,6 +27,7 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "common/intops.h"
@@ -101,6 +102,14 @@ static void backup_lpf(const Dav1dFrameContext *const f,
     }
 }
 
+static void wrap_lpf_ring(pixel *const dst, const ptrdiff_t stride,
+                          const int n_lines)
+{
+    for (int i = 0; i < 4; i++)
+        memcpy(&dst[(i - 4) * PXSTRIDE(stride)],
+               &dst[(n_lines - 4 + i) * PXSTRIDE(stride)], llabs(stride));
+}
+
 void bytefn(dav1d_copy_lpf)(Dav1dFrameContext *const f,
                             /*const*/ pixel *const src[3], const int sby)
 {
@@ -109,7 +118,8 @@ void bytefn(dav1d_copy_lpf)(Dav1dFrameContext *const f,
     const int offset = 8 * !!sby;
     const ptrdiff_t *const src_stride = f->cur.stride;
     const ptrdiff_t *const lr_stride = f->sr_cur.p.stride;
-    const int tt_off = have_tt * sby * (4 << f->seq_hdr->sb128);
+    const int ring_sby = sby % f->lf.line_buf_sbh;
+    const int tt_off = have_tt * ring_sby * (4 << f->seq_hdr->sb128);
     pixel *const dst[3] = {
         f->lf.lr_lpf_line[0] + tt_off * PXSTRIDE(lr_stride[0]),
         f->lf.lr_lpf_line[1] + tt_off * PXSTRIDE(lr_stride[1]),
@@ -117,7 +127,9 @@ void bytefn(dav1d_copy_lpf)(Dav1dFrameContext *const f,
     };
 
     // TODO Also check block level restore type to reduce copying.
-    const int restore_planes = f->lf.restore_planes;
+    const int restore_planes = f->c->luma_only ?
+                               f->lf.restore_planes & LR_RESTORE_Y :
+                               f->lf.restore_planes;
 
     if (f->seq_hdr->cdef || restore_planes & LR_RESTORE_Y) {
         const int h = f->cur.p.h;
@@ -129,14 +141,14 @@ void bytefn(dav1d_copy_lpf)(Dav1dFrameContext *const f,
                        src[0] - offset * PXSTRIDE(src_stride[0]), src_stride[0],
                        0, f->seq_hdr->sb128, y_stripe, row_h, w, h, 0, 1);
         if (have_tt && resize) {
-            const ptrdiff_t cdef_off_y = sby * 4 * PXSTRIDE(src_stride[0]);
+            const ptrdiff_t cdef_off_y = ring_sby * 4 * PXSTRIDE(src_stride[0]);
             backup_lpf(f, f->lf.cdef_lpf_line[0] + cdef_off_y, src_stride[0],
                        src[0] - offset * PXSTRIDE(src_stride[0]), src_stride[0],
                        0, f->seq_hdr->sb128, y_stripe, row_h, w, h, 0, 0);
         }
     }
     if ((f->seq_hdr->cdef || restore_planes & (LR_RESTORE_U | LR_RESTORE_V)) &&
-        f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400)
+        f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400 && !f->c->luma_only)
     {
         const int ss_ver = f->sr_cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
         const int ss_hor = f->sr_cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
@@ -145,7 +157,7 @@ void bytefn(dav1d_copy_lpf)(Dav1dFrameContext *const f,
         const int row_h = imin((sby + 1) << ((6 - ss_ver) + f->seq_hdr->sb128), h - 1);
         const int offset_uv = offset >> ss_ver;
         const int y_stripe = (sby << ((6 - ss_ver) + f->seq_hdr->sb128)) - offset_uv;
-        const ptrdiff_t cdef_off_uv = sby * 4 * PXSTRIDE(src_stride[1]);
+        const ptrdiff_t cdef_off_uv = ring_sby * 4 * PXSTRIDE(src_stride[1]);
         if (f->seq_hdr->cdef || restore_planes & LR_RESTORE_U) {
             if (restore_planes & LR_RESTORE_U || !resize)
                 backup_lpf(f, dst[1], lr_stride[1],
@@ -171,6 +183,26 @@ void bytefn(dav1d_copy_lpf)(Dav1dFrameContext *const f,
                            row_h, w, h, ss_hor, 0);
         }
     }
+
+    // The sbrow following the last slot of the ring wraps around to the
+    // first slot, and finds the bottom lines of this sbrow in the 4 lines
+    // in front of it.
+    if (have_tt && ring_sby == f->lf.line_buf_sbh - 1 && sby + 1 < f->sbh) {
+        const int lr_lines = f->lf.line_buf_sbh * (4 << f->seq_hdr->sb128);
+        wrap_lpf_ring(f->lf.lr_lpf_line[0], lr_stride[0], lr_lines);
+        if (f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400 && !f->c->luma_only) {
+            wrap_lpf_ring(f->lf.lr_lpf_line[1], lr_stride[1], lr_lines);
+            wrap_lpf_ring(f->lf.lr_lpf_line[2], lr_stride[1], lr_lines);
+        }
+        if (resize) {
+            const int cdef_lines = f->lf.line_buf_sbh * 4;
+            wrap_lpf_ring(f->lf.cdef_lpf_line[0], src_stride[0], cdef_lines);
+            if (f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400 && !f->c->luma_only) {
+                wrap_lpf_ring(f->lf.cdef_lpf_line[1], src_stride[1], cdef_lines);
+                wrap_lpf_ring(f->lf.cdef_lpf_line[2], src_stride[1], cdef_lines);
+            }
+        }
+    }
 }
 
 static inline void filter_plane_cols_y(const Dav1dFrameContext *const f,
@@ -410,8 +442,11 @@ void bytefn(dav1d_loopfilter_sbrow_cols)(const Dav1dFrameContext *const f,
                             imin(32, f->w4 - x * 32), starty4, endy4);
     }
 
-    if (!f->frame_hdr->loopfilter.level_u && !f->frame_hdr->loopfilter.level_v)
+    if (f->c->luma_only ||
+        (!f->frame_hdr->loopfilter.level_u && !f->frame_hdr->loopfilter.level_v))
+    {
         return;
+    }
 
     ptrdiff_t uv_off;
     level_ptr = f->lf.level + f->b4_stride * (sby * sbsz >> ss_ver);
@@ -449,8 +484,11 @@ void bytefn(dav1d_loopfilter_sbrow_rows)(const Dav1dFrameContext *const f,
                             imin(32, f->w4 - x * 32), starty4, endy4);
     }
 
-    if (!f->frame_hdr->loopfilter.level_u && !f->frame_hdr->loopfilter.level_v)
+    if (f->c->luma_only ||
+        (!f->frame_hdr->loopfilter.level_u && !f->frame_hdr->loopfilter.level_v))
+    {
         return;
+    }
 
     ptrdiff_t uv_off;
     level_ptr = f->lf.level + f->b4_stride * (sby * sbsz >> ss_ver);
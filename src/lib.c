@@ -40,14 +40,17 @@
 
 #include "common/validate.h"
 
+#include "src/clock.h"
 #include "src/cpu.h"
 #include "src/fg_apply.h"
+#include "src/gop.h"
 #include "src/internal.h"
 #include "src/log.h"
 #include "src/obu.h"
 #include "src/qm.h"
 #include "src/ref.h"
 #include "src/thread_task.h"
+#include "src/trace.h"
 #include "src/wedge.h"
 
 static COLD void init_internal(void) {
@@ -84,6 +87,20 @@ COLD void dav1d_default_settings(Dav1dSettings *const s) {
     s->output_invisible_frames = 0;
     s->inloop_filters = DAV1D_INLOOPFILTER_ALL;
     s->decode_frame_type = DAV1D_DECODEFRAMETYPE_ALL;
+    s->decode_stats = 0;
+    s->perf_counters = 0;
+    s->stall_stats = 0;
+    s->resync = 0;
+    s->frame_block_limit = 0;
+    s->thread_affinity = DAV1D_THREAD_AFFINITY_NONE;
+    s->energy_saving = 0;
+    s->target_fps_num = 0;
+    s->target_fps_den = 0;
+    s->parallel_gops = 0;
+    s->luma_only = 0;
+    s->entropy_only = 0;
+    s->dirty_regions = 0;
+    s->work_stats = 0;
 }
 
 static void close_internal(Dav1dContext **const c_out, int flush);
@@ -104,6 +121,63 @@ static COLD size_t get_stack_size_internal(const pthread_attr_t *const thread_at
     return 0;
 }
 
+#ifdef HAVE_CPU_TOPOLOGY
+// decoders are distributed over the L3 domains in the order they are opened
+static atomic_uint next_l3_domain;
+#endif
+
+// number of CPUs available to the worker threads
+static COLD int get_num_cpus(Dav1dContext *const c, const Dav1dSettings *const s) {
+#ifdef HAVE_CPU_TOPOLOGY
+    if (s->thread_affinity == DAV1D_THREAD_AFFINITY_L3) {
+        if (c) {
+            if (c->n_worker_cpus) return c->n_worker_cpus;
+        } else {
+            // the domain that the next opened decoder will be confined to
+            cpu_set_t set;
+            if (dav1d_get_l3_domain(atomic_load(&next_l3_domain), &set))
+                return CPU_COUNT(&set);
+        }
+    }
+#endif
+    return dav1d_num_logical_processors(c);
+}
+
+// picks the CPUs the worker threads are confined to
+static COLD void init_worker_cpus(Dav1dContext *const c, const Dav1dSettings *const s) {
+    if (s->thread_affinity == DAV1D_THREAD_AFFINITY_NONE) return;
+#ifdef HAVE_CPU_TOPOLOGY
+    const unsigned idx = atomic_fetch_add(&next_l3_domain, 1);
+    if (dav1d_get_l3_domain(idx, &c->worker_cpus)) {
+        c->n_worker_cpus = CPU_COUNT(&c->worker_cpus);
+        return;
+    }
+#endif
+    dav1d_log(c, "Unable to detect the L3 cache topology, not confining threads\n");
+}
+
+#ifdef HAVE_CPU_TOPOLOGY
+// confines the worker threads to c->worker_cpus, or leaves all of them
+// unconfined if that fails for any of them
+static COLD void pin_worker_threads(Dav1dContext *const c) {
+    for (unsigned n = 0; n < c->n_tc; n++) {
+        if (!pthread_setaffinity_np(c->tc[n].task_thread.td.thread,
+                                    sizeof(c->worker_cpus), &c->worker_cpus))
+        {
+            continue;
+        }
+        cpu_set_t allowed;
+        if (!pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed))
+            for (unsigned i = 0; i < n; i++)
+                pthread_setaffinity_np(c->tc[i].task_thread.td.thread,
+                                       sizeof(allowed), &allowed);
+        dav1d_log(c, "Failed to set the thread affinity, not confining threads\n");
+        c->n_worker_cpus = 0;
+        return;
+    }
+}
+#endif
+
 static COLD void get_num_threads(Dav1dContext *const c, const Dav1dSettings *const s,
                                  unsigned *n_tc, unsigned *n_fc)
 {
@@ -118,8 +192,14 @@ static COLD void get_num_threads(Dav1dContext *const c, const Dav1dSettings *con
         7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, /* 37-49 */
     };
     *n_tc = s->n_threads ? s->n_threads :
-        iclip(dav1d_num_logical_processors(c), 1, DAV1D_MAX_THREADS);
+        iclip(get_num_cpus(c, s), 1, DAV1D_MAX_THREADS);
+    // intra frames don't depend on each other, so when only those are
+    // decoded, frame threading can use one frame context per thread without
+    // extra stalls; each one holds a picture and its per-frame buffers, so
+    // memory grows with the thread count unless max_frame_delay is set
     *n_fc = s->max_frame_delay ? umin(s->max_frame_delay, *n_tc) :
+            s->decode_frame_type >= DAV1D_DECODEFRAMETYPE_INTRA ?
+                umin(*n_tc, DAV1D_MAX_FRAME_DELAY) :
             *n_tc < 50 ? fc_lut[*n_tc - 1] : 8; // min(8, ceil(sqrt(n)))
 }
 
@@ -153,6 +233,11 @@ COLD int dav1d_open(Dav1dContext **const c_out, const Dav1dSettings *const s) {
                           s->operating_point <= 31, DAV1D_ERR(EINVAL));
     validate_input_or_ret(s->decode_frame_type >= DAV1D_DECODEFRAMETYPE_ALL &&
                           s->decode_frame_type <= DAV1D_DECODEFRAMETYPE_KEY, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(s->thread_affinity >= DAV1D_THREAD_AFFINITY_NONE &&
+                          s->thread_affinity <= DAV1D_THREAD_AFFINITY_L3, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(!s->target_fps_num == !s->target_fps_den, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(s->parallel_gops >= 0 &&
+                          s->parallel_gops <= DAV1D_MAX_THREADS, DAV1D_ERR(EINVAL));
 
     pthread_attr_t thread_attr;
     if (pthread_attr_init(&thread_attr)) return DAV1D_ERR(ENOMEM);
@@ -174,6 +259,16 @@ COLD int dav1d_open(Dav1dContext **const c_out, const Dav1dSettings *const s) {
     c->output_invisible_frames = s->output_invisible_frames;
     c->inloop_filters = s->inloop_filters;
     c->decode_frame_type = s->decode_frame_type;
+    c->decode_stats = s->decode_stats;
+    c->perf_counters = s->perf_counters;
+    c->stall_stats = s->stall_stats;
+    c->resync = s->resync;
+    c->frame_block_limit = s->frame_block_limit;
+    c->luma_only = s->luma_only;
+    c->entropy_only = s->entropy_only;
+    c->dirty_regions = s->dirty_regions;
+    c->work_stats = s->work_stats;
+    c->count_work = s->work_stats || s->frame_block_limit || s->entropy_only;
 
     dav1d_data_props_set_defaults(&c->cached_error_props);
 
@@ -182,7 +277,10 @@ COLD int dav1d_open(Dav1dContext **const c_out, const Dav1dSettings *const s) {
         dav1d_mem_pool_init(ALLOC_SEGMAP, &c->segmap_pool) ||
         dav1d_mem_pool_init(ALLOC_REFMVS, &c->refmvs_pool) ||
         dav1d_mem_pool_init(ALLOC_PIC_CTX, &c->pic_ctx_pool) ||
-        dav1d_mem_pool_init(ALLOC_CDF, &c->cdf_pool))
+        dav1d_mem_pool_init(ALLOC_CDF, &c->cdf_pool) ||
+        dav1d_mem_pool_init(ALLOC_OBU_META, &c->decode_stats_pool) ||
+        dav1d_mem_pool_init(ALLOC_BLOCK, &c->block_info_pool) ||
+        dav1d_mem_pool_init(ALLOC_BLOCK, &c->dirty_map_pool))
     {
         goto error;
     }
@@ -213,9 +311,23 @@ COLD int dav1d_open(Dav1dContext **const c_out, const Dav1dSettings *const s) {
     c->flush = &c->flush_mem;
     atomic_init(c->flush, 0);
 
+    if (s->parallel_gops > 1) {
+        const unsigned n_threads = s->n_threads ? s->n_threads :
+            iclip(dav1d_num_logical_processors(c), 1, DAV1D_MAX_THREADS);
+        if (dav1d_gop_open(c, s, n_threads)) goto error;
+        pthread_attr_destroy(&thread_attr);
+        return 0;
+    }
+
+    init_worker_cpus(c, s);
     get_num_threads(c, s, &c->n_tc, &c->n_fc);
+    c->energy.enabled = s->energy_saving && c->n_tc > 1;
+    c->energy.fps_num = s->target_fps_num;
+    c->energy.fps_den = s->target_fps_den;
+    c->track_idle = c->stall_stats || c->energy.enabled;
+    c->energy.window_start = dav1d_clock_ns();
 
-    c->fc = dav1d_alloc_aligned(ALLOC_THREAD_CTX, sizeof(*c->fc) * c->n_fc, 32);
+    c->fc = dav1d_alloc_aligned(ALLOC_THREAD_CTX, sizeof(*c->fc) * c->n_fc, 64);
     if (!c->fc) goto error;
     memset(c->fc, 0, sizeof(*c->fc) * c->n_fc);
 
@@ -233,7 +345,14 @@ COLD int dav1d_open(Dav1dContext **const c_out, const Dav1dSettings *const s) {
             pthread_mutex_destroy(&c->task_thread.lock);
             goto error;
         }
+        if (pthread_cond_init(&c->task_thread.parked_cond, NULL)) {
+            pthread_cond_destroy(&c->task_thread.delayed_fg.cond);
+            pthread_cond_destroy(&c->task_thread.cond);
+            pthread_mutex_destroy(&c->task_thread.lock);
+            goto error;
+        }
         c->task_thread.cur = c->n_fc;
+        c->task_thread.n_active = c->n_tc;
         atomic_init(&c->task_thread.reset_task_cur, UINT_MAX);
         atomic_init(&c->task_thread.cond_signaled, 0);
         c->task_thread.inited = 1;
@@ -283,8 +402,24 @@ COLD int dav1d_open(Dav1dContext **const c_out, const Dav1dSettings *const s) {
                 goto error;
             }
             t->task_thread.td.inited = 1;
+        } else if (c->perf_counters) {
+            dav1d_perf_thread_open(&t->perf);
         }
     }
+#ifdef HAVE_CPU_TOPOLOGY
+    if (c->n_tc > 1 && c->n_worker_cpus)
+        pin_worker_threads(c);
+#endif
+#if defined(HAVE_CPU_TOPOLOGY) && defined(HAVE_SCHED_GETCPU)
+    // after pinning, since it depends on the CPUs the workers may run on
+    if (c->n_tc > 1) {
+        pthread_mutex_lock(&c->task_thread.lock);
+        c->n_fast_cpus = dav1d_get_fast_cpus(DAV1D_SYSFS_CPU_ROOT,
+                                             c->n_worker_cpus ? &c->worker_cpus : NULL,
+                                             &c->fast_cpus);
+        pthread_mutex_unlock(&c->task_thread.lock);
+    }
+#endif
     dav1d_pal_dsp_init(&c->pal_dsp);
     dav1d_refmvs_dsp_init(&c->refmvs_dsp);
 
@@ -306,24 +441,145 @@ static int has_grain(const Dav1dPicture *const pic)
                                         fgdata->chroma_scaling_from_luma);
 }
 
+// Film grain is applied on output, after the decoding cost of the frame has
+// been finalized, so the output picture gets its own copy of the statistics.
+static int add_grain_stats(Dav1dContext *const c, Dav1dPicture *const out,
+                           const uint64_t time)
+{
+    Dav1dRef *const ref =
+        dav1d_ref_create_using_pool(c->decode_stats_pool, sizeof(Dav1dDecodeStats));
+    if (!ref) return DAV1D_ERR(ENOMEM);
+
+    Dav1dDecodeStats *const stats = ref->data;
+    *stats = *out->decode_stats;
+    const uint64_t cpu_time = stats->cpu_time + time;
+    if (cpu_time) {
+        const float scale = (float) ((double) stats->cpu_time / cpu_time);
+        for (int i = 0; i < DAV1D_N_DECODE_STAGES; i++)
+            stats->stage_fraction[i] *= scale;
+        stats->stage_fraction[DAV1D_DECODE_STAGE_FILM_GRAIN] +=
+            (float) ((double) time / cpu_time);
+    }
+    stats->cpu_time = cpu_time;
+    stats->wall_time += time;
+
+    dav1d_ref_dec(&out->decode_stats_ref);
+    out->decode_stats_ref = ref;
+    out->decode_stats = stats;
+    return 0;
+}
+
+// time the worker threads spent running tasks, summed over threads;
+// must be called with c->task_thread.lock held
+static uint64_t get_busy_time(const Dav1dContext *const c, const uint64_t now) {
+    uint64_t busy = 0;
+    for (unsigned n = 0; n < c->n_tc; n++) {
+        const Dav1dTaskContext *const tc = &c->tc[n];
+        if (!tc->task_thread.stall.start) continue; // not started yet
+        uint64_t idle = tc->task_thread.stall.wait_start ?
+                        now - tc->task_thread.stall.wait_start : 0;
+        for (int i = 0; i < DAV1D_N_STALL_REASONS; i++)
+            idle += tc->task_thread.stall.time[i];
+        busy += now - tc->task_thread.stall.start - idle;
+    }
+    return busy;
+}
+
+#define ENERGY_WINDOW_NS 250000000
+
+// Energy saving mode: every window, derive from the core time spent per
+// picture how many worker threads are needed to keep up with the target
+// frame rate, with some headroom for the dependencies between tasks which
+// keep threads from being fully busy, and park the others.
+static void update_active_threads(Dav1dContext *const c) {
+    const uint64_t now = dav1d_clock_ns();
+    if (!c->energy.frames++) c->energy.first = now;
+    c->energy.last = now;
+    c->energy.window_frames++;
+    const uint64_t elapsed = now - c->energy.window_start;
+    if (elapsed < ENERGY_WINDOW_NS || c->energy.window_frames < 2) return;
+
+    double fps = 0.0;
+    if (c->energy.fps_num) {
+        fps = (double) c->energy.fps_num / c->energy.fps_den;
+    } else if (c->seq_hdr && c->seq_hdr->timing_info_present &&
+               c->seq_hdr->num_units_in_tick)
+    {
+        const Dav1dSequenceHeader *const seq_hdr = c->seq_hdr;
+        fps = (double) seq_hdr->time_scale / seq_hdr->num_units_in_tick;
+        if (seq_hdr->equal_picture_interval)
+            fps /= seq_hdr->num_ticks_per_picture;
+    }
+
+    struct TaskThreadData *const ttd = &c->task_thread;
+    pthread_mutex_lock(&ttd->lock);
+    const uint64_t busy = get_busy_time(c, now);
+    unsigned n_active = c->n_tc;
+    if (fps > 0.0) {
+        const double frame_time = (double) (busy - c->energy.window_busy) /
+                                  c->energy.window_frames;
+        const double load = frame_time * 1e-9 * fps; // in threads
+        if (load * 1.25 < c->n_tc)
+            n_active = (unsigned) (load * 1.25) + 1;
+        // keep adding threads while the active ones are saturated and the
+        // target is not met, in case the measured cost was too low
+        const int behind = c->energy.window_frames < elapsed * 1e-9 * fps;
+        const int saturated = busy - c->energy.window_busy >=
+                              (uint64_t) ttd->n_active * elapsed / 10 * 9;
+        if (behind && saturated)
+            n_active = umin(umax(n_active, ttd->n_active + 1), c->n_tc);
+    }
+    c->energy.active_time += ttd->n_active * elapsed;
+    if (n_active > ttd->n_active)
+        pthread_cond_broadcast(&ttd->parked_cond);
+    ttd->n_active = n_active;
+    pthread_mutex_unlock(&ttd->lock);
+
+    c->energy.window_start = now;
+    c->energy.window_busy = busy;
+    c->energy.window_frames = 0;
+}
+
+// With luma_only, the chroma planes are never reconstructed, so hide them
+// from the output picture; their buffers are released with the picture.
+static void strip_chroma(Dav1dPicture *const p) {
+    p->p.layout = DAV1D_PIXEL_LAYOUT_I400;
+    p->data[1] = p->data[2] = NULL;
+    p->stride[1] = 0;
+}
+
 static int output_image(Dav1dContext *const c, Dav1dPicture *const out)
 {
     int res = 0;
 
     Dav1dThreadPicture *const in = (c->all_layers || !c->max_spatial_id)
                                    ? &c->out : &c->cache;
-    if (!c->apply_grain || !has_grain(&in->p)) {
+    // stripped before film grain, which then skips chroma and allocates
+    // its output picture as I400
+    if (c->luma_only) strip_chroma(&in->p);
+    if (!c->apply_grain || c->entropy_only || !has_grain(&in->p)) {
         dav1d_picture_move_ref(out, &in->p);
         dav1d_thread_picture_unref(in);
         goto end;
     }
 
+    const uint64_t start = in->p.decode_stats ? dav1d_clock_ns() : 0;
+    // with n_threads > 1, film grain is measured by the worker threads
+    Dav1dPerfThread *const perf = c->n_tc == 1 && c->tc[0].perf.n ?
+                                  &c->tc[0].perf : NULL;
+    if (perf) dav1d_perf_thread_start(perf);
     res = dav1d_apply_grain(c, out, &in->p);
+    if (perf) dav1d_perf_thread_sample(perf, DAV1D_PERF_TASK_FILM_GRAIN);
     dav1d_thread_picture_unref(in);
+    if (!res && out->decode_stats) {
+        res = add_grain_stats(c, out, dav1d_clock_ns() - start);
+        if (res < 0) dav1d_picture_unref_internal(out);
+    }
 end:
     if (!c->all_layers && c->max_spatial_id && c->out.p.data[0]) {
         dav1d_thread_picture_move_ref(in, &c->out);
     }
+    if (!res && c->energy.enabled) update_active_threads(c);
     return res;
 }
 
@@ -442,25 +698,33 @@ int dav1d_send_data(Dav1dContext *const c, Dav1dData *const in)
         validate_input_or_ret(in->sz > 0 && in->sz <= SIZE_MAX / 2, DAV1D_ERR(EINVAL));
         c->drain = 0;
     }
-    if (c->in.data)
+    dav1d_trace2(send_data_entry, c, in->sz);
+    if (c->gop) {
+        const int res = dav1d_gop_send_data(c, in);
+        dav1d_trace2(send_data_return, c, res);
+        return res;
+    }
+    if (c->in.data) {
+        dav1d_trace2(send_data_return, c, DAV1D_ERR(EAGAIN));
         return DAV1D_ERR(EAGAIN);
+    }
     dav1d_data_ref(&c->in, in);
 
     int res = gen_picture(c);
     if (!res)
         dav1d_data_unref_internal(in);
 
+    dav1d_trace2(send_data_return, c, res);
     return res;
 }
 
-int dav1d_get_picture(Dav1dContext *const c, Dav1dPicture *const out)
+static int get_picture(Dav1dContext *const c, Dav1dPicture *const out)
 {
-    validate_input_or_ret(c != NULL, DAV1D_ERR(EINVAL));
-    validate_input_or_ret(out != NULL, DAV1D_ERR(EINVAL));
-
     const int drain = c->drain;
     c->drain = 1;
 
+    if (c->gop) return dav1d_gop_get_picture(c, out, drain);
+
     int res = gen_picture(c);
     if (res < 0)
         return res;
@@ -480,6 +744,17 @@ int dav1d_get_picture(Dav1dContext *const c, Dav1dPicture *const out)
     return DAV1D_ERR(EAGAIN);
 }
 
+int dav1d_get_picture(Dav1dContext *const c, Dav1dPicture *const out)
+{
+    validate_input_or_ret(c != NULL, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(out != NULL, DAV1D_ERR(EINVAL));
+
+    dav1d_trace1(get_picture_entry, c);
+    const int res = get_picture(c, out);
+    dav1d_trace2(get_picture_return, c, res);
+    return res;
+}
+
 int dav1d_apply_grain(Dav1dContext *const c, Dav1dPicture *const out,
                       const Dav1dPicture *const in)
 {
@@ -487,6 +762,7 @@ int dav1d_apply_grain(Dav1dContext *const c, Dav1dPicture *const out,
     validate_input_or_ret(out != NULL, DAV1D_ERR(EINVAL));
     validate_input_or_ret(in != NULL, DAV1D_ERR(EINVAL));
 
+    if (c->gop) return dav1d_gop_apply_grain(c, out, in);
     if (!has_grain(in)) {
         dav1d_picture_ref(out, in);
         return 0;
@@ -522,11 +798,19 @@ error:
 }
 
 void dav1d_flush(Dav1dContext *const c) {
+    dav1d_trace1(flush, c);
+    if (c->gop) {
+        dav1d_gop_flush(c);
+        c->drain = 0;
+        return;
+    }
     dav1d_data_unref_internal(&c->in);
     if (c->out.p.frame_hdr)
         dav1d_thread_picture_unref(&c->out);
     if (c->cache.p.frame_hdr)
         dav1d_thread_picture_unref(&c->cache);
+    if (c->dirty_prev.frame_hdr)
+        dav1d_picture_unref_internal(&c->dirty_prev);
 
     c->drain = 0;
     c->cached_error = 0;
@@ -611,6 +895,7 @@ static COLD void close_internal(Dav1dContext **const c_out, int flush) {
 
     if (flush) dav1d_flush(c);
 
+    if (c->gop) dav1d_gop_close(c);
     if (c->tc) {
         struct TaskThreadData *ttd = &c->task_thread;
         if (ttd->inited) {
@@ -618,6 +903,7 @@ static COLD void close_internal(Dav1dContext **const c_out, int flush) {
             for (unsigned n = 0; n < c->n_tc && c->tc[n].task_thread.td.inited; n++)
                 c->tc[n].task_thread.die = 1;
             pthread_cond_broadcast(&ttd->cond);
+            pthread_cond_broadcast(&ttd->parked_cond);
             pthread_mutex_unlock(&ttd->lock);
             for (unsigned n = 0; n < c->n_tc; n++) {
                 Dav1dTaskContext *const pf = &c->tc[n];
@@ -626,9 +912,12 @@ static COLD void close_internal(Dav1dContext **const c_out, int flush) {
                 pthread_cond_destroy(&pf->task_thread.td.cond);
                 pthread_mutex_destroy(&pf->task_thread.td.lock);
             }
+            pthread_cond_destroy(&ttd->parked_cond);
             pthread_cond_destroy(&ttd->delayed_fg.cond);
             pthread_cond_destroy(&ttd->cond);
             pthread_mutex_destroy(&ttd->lock);
+        } else {
+            dav1d_perf_thread_close(&c->tc[0].perf);
         }
         dav1d_free_aligned(c->tc);
     }
@@ -660,12 +949,14 @@ static COLD void close_internal(Dav1dContext **const c_out, int flush) {
         dav1d_free(f->tile);
         dav1d_free(f->lf.mask);
         dav1d_free(f->lf.level);
+        dav1d_free(f->dirty.copied);
         dav1d_free(f->lf.lr_mask);
         dav1d_free(f->lf.tx_lpf_right_edge[0]);
         dav1d_free(f->lf.start_of_tile_row);
         dav1d_free_aligned(f->rf.r);
         dav1d_free_aligned(f->lf.cdef_line_buf);
         dav1d_free_aligned(f->lf.lr_line_buf);
+        dav1d_free_aligned(f->stats.time);
     }
     dav1d_free_aligned(c->fc);
     if (c->n_fc > 1 && c->frame_thread.out_delayed) {
@@ -684,6 +975,8 @@ static COLD void close_internal(Dav1dContext **const c_out, int flush) {
         dav1d_ref_dec(&c->refs[n].refmvs);
         dav1d_ref_dec(&c->refs[n].segmap);
     }
+    if (c->dirty_prev.frame_hdr)
+        dav1d_picture_unref_internal(&c->dirty_prev);
     dav1d_ref_dec(&c->seq_hdr_ref);
     dav1d_ref_dec(&c->frame_hdr_ref);
 
@@ -698,6 +991,9 @@ static COLD void close_internal(Dav1dContext **const c_out, int flush) {
     dav1d_mem_pool_end(c->cdf_pool);
     dav1d_mem_pool_end(c->picture_pool);
     dav1d_mem_pool_end(c->pic_ctx_pool);
+    dav1d_mem_pool_end(c->decode_stats_pool);
+    dav1d_mem_pool_end(c->block_info_pool);
+    dav1d_mem_pool_end(c->dirty_map_pool);
 
     dav1d_freep_aligned(c_out);
 }
@@ -708,6 +1004,92 @@ int dav1d_get_event_flags(Dav1dContext *const c, enum Dav1dEventFlags *const fla
 
     *flags = c->event_flags;
     c->event_flags = 0;
+    for (unsigned i = 0; i < c->n_fc; i++)
+        if (atomic_exchange(&c->fc[i].block_limit_hit, 0))
+            *flags |= DAV1D_EVENT_FLAG_FRAME_BLOCK_LIMIT;
+    return 0;
+}
+
+int dav1d_get_perf_counters(Dav1dContext *const c, Dav1dPerfCounters *const out) {
+    validate_input_or_ret(c != NULL, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(out != NULL, DAV1D_ERR(EINVAL));
+
+    if (!c->perf_counters || c->gop) return DAV1D_ERR(ENOSYS);
+
+    memset(out, 0, sizeof(*out));
+    out->available = ~0U;
+    for (unsigned n = 0; n < c->n_tc; n++)
+        dav1d_perf_thread_add(&c->tc[n].perf, out);
+
+    return out->available ? 0 : DAV1D_ERR(ENOSYS);
+}
+
+int dav1d_get_stall_stats(Dav1dContext *const c, Dav1dStallStats *const out) {
+    validate_input_or_ret(c != NULL, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(out != NULL, DAV1D_ERR(EINVAL));
+
+    if (!c->stall_stats || c->n_tc == 1 || c->gop) return DAV1D_ERR(ENOSYS);
+
+    memset(out, 0, sizeof(*out));
+    out->n_threads = c->n_tc;
+    pthread_mutex_lock(&c->task_thread.lock);
+    const uint64_t now = dav1d_clock_ns();
+    for (unsigned n = 0; n < c->n_tc; n++) {
+        const Dav1dTaskContext *const tc = &c->tc[n];
+        if (!tc->task_thread.stall.start) continue; // not started yet
+        uint64_t idle = 0;
+        for (int i = 0; i < DAV1D_N_STALL_REASONS; i++) {
+            out->stall_time[i] += tc->task_thread.stall.time[i];
+            out->stalls[i] += tc->task_thread.stall.count[i];
+            idle += tc->task_thread.stall.time[i];
+        }
+        // account for the idle period in progress
+        if (tc->task_thread.stall.wait_start) {
+            const uint64_t wait = now - tc->task_thread.stall.wait_start;
+            out->stall_time[tc->task_thread.stall.reason] += wait;
+            idle += wait;
+        }
+        out->busy_time += now - tc->task_thread.stall.start - idle;
+    }
+    pthread_mutex_unlock(&c->task_thread.lock);
+
+    return 0;
+}
+
+int dav1d_get_energy_stats(Dav1dContext *const c, Dav1dEnergyStats *const out) {
+    validate_input_or_ret(c != NULL, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(out != NULL, DAV1D_ERR(EINVAL));
+
+    if (!c->energy.enabled) return DAV1D_ERR(ENOSYS);
+
+    memset(out, 0, sizeof(*out));
+    out->n_threads = c->n_tc;
+    out->frames = c->energy.frames;
+    out->time = c->energy.last - c->energy.first;
+    pthread_mutex_lock(&c->task_thread.lock);
+    const uint64_t now = dav1d_clock_ns();
+    out->active_threads = c->task_thread.n_active;
+    out->busy_time = get_busy_time(c, now);
+    out->active_time = c->energy.active_time +
+                       c->task_thread.n_active * (now - c->energy.window_start);
+    pthread_mutex_unlock(&c->task_thread.lock);
+
+    return 0;
+}
+
+int dav1d_get_work_stats(Dav1dContext *const c, Dav1dWorkStats *const out) {
+    validate_input_or_ret(c != NULL, DAV1D_ERR(EINVAL));
+    validate_input_or_ret(out != NULL, DAV1D_ERR(EINVAL));
+
+    if (!c->work_stats || c->gop) return DAV1D_ERR(ENOSYS);
+
+    if (c->n_tc > 1) pthread_mutex_lock(&c->task_thread.lock);
+    out->frames = c->work.frames;
+    out->blocks = c->work.blocks;
+    out->coefs = c->work.coefs;
+    out->tasks = c->work.tasks;
+    if (c->n_tc > 1) pthread_mutex_unlock(&c->task_thread.lock);
+
     return 0;
 }
 
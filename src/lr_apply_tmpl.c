@@ -43,9 +43,10 @@ static void lr_stripe(const Dav1dFrameContext *const f, pixel *p,
     const int ss_ver = chroma & (f->sr_cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420);
     const ptrdiff_t stride = f->sr_cur.p.stride[chroma];
     const int sby = (y + (y ? 8 << ss_ver : 0)) >> (6 - ss_ver + f->seq_hdr->sb128);
+    const int ring_sby = sby % f->lf.line_buf_sbh;
     const int have_tt = f->c->n_tc > 1;
     const pixel *lpf = f->lf.lr_lpf_line[plane] +
-        have_tt * (sby * (4 << f->seq_hdr->sb128) - 4) * PXSTRIDE(stride) + x;
+        have_tt * (ring_sby * (4 << f->seq_hdr->sb128) - 4) * PXSTRIDE(stride) + x;
 
     // The first stripe of the frame is shorter by 8 luma pixel rows.
     int stripe_h = imin((64 - 8 * !y) >> ss_ver, row_h - y);
@@ -170,7 +171,9 @@ void bytefn(dav1d_lr_sbrow)(Dav1dFrameContext *const f, pixel *const dst[3],
 {
     const int offset_y = 8 * !!sby;
     const ptrdiff_t *const dst_stride = f->sr_cur.p.stride;
-    const int restore_planes = f->lf.restore_planes;
+    const int restore_planes = f->c->luma_only ?
+                               f->lf.restore_planes & LR_RESTORE_Y :
+                               f->lf.restore_planes;
     const int not_last = sby + 1 < f->sbh;
 
     if (restore_planes & LR_RESTORE_Y) {
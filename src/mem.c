@@ -30,6 +30,7 @@
 #include <stdint.h>
 
 #include "src/internal.h"
+#include "src/trace.h"
 
 #if TRACK_HEAP_ALLOCATIONS
 #include <stdio.h>
@@ -231,37 +232,98 @@ COLD void dav1d_log_alloc_stats(Dav1dContext *const c) {
 #endif /* TRACK_HEAP_ALLOCATIONS */
 
 static COLD void mem_pool_destroy(Dav1dMemPool *const pool) {
-    pthread_mutex_destroy(&pool->lock);
-    dav1d_free(pool);
+    dav1d_free_aligned(pool);
+}
+
+// where the calling thread starts probing the cache slots; derived from
+// the stack address so that concurrent threads mostly use distinct slots
+static inline unsigned mem_pool_cache_idx(void) {
+    int stack;
+    return ((uint32_t)((uintptr_t)&stack >> 16) * 0x9E3779B1U) >> 24;
+}
+
+// push a chain of linked buffers onto the overflow stack
+static void mem_pool_push_list(Dav1dMemPool *const pool,
+                               Dav1dMemPoolBuffer *const first,
+                               Dav1dMemPoolBuffer *const last)
+{
+    uintptr_t head = 0;
+    do {
+        last->next = (Dav1dMemPoolBuffer *) head;
+    } while (!atomic_compare_exchange_strong(&pool->buf, &head, (uintptr_t) first));
+}
+
+static void mem_pool_insert(Dav1dMemPool *const pool, Dav1dMemPoolBuffer *const buf) {
+    const unsigned idx = mem_pool_cache_idx();
+    for (unsigned i = 0; i < DAV1D_MEM_POOL_CACHE_SIZE; i++) {
+        uintptr_t empty = 0;
+        if (atomic_compare_exchange_strong(&pool->cache[(idx + i) % DAV1D_MEM_POOL_CACHE_SIZE].buf,
+                                           &empty, (uintptr_t) buf))
+        {
+            return;
+        }
+    }
+    mem_pool_push_list(pool, buf, buf);
+}
+
+static Dav1dMemPoolBuffer *mem_pool_remove(Dav1dMemPool *const pool) {
+    const unsigned idx = mem_pool_cache_idx();
+    for (unsigned i = 0; i < DAV1D_MEM_POOL_CACHE_SIZE; i++) {
+        Dav1dMemPoolBuffer *const buf = (Dav1dMemPoolBuffer *)
+            atomic_exchange(&pool->cache[(idx + i) % DAV1D_MEM_POOL_CACHE_SIZE].buf, 0);
+        if (buf) return buf;
+    }
+    // detach the whole overflow stack rather than popping a single
+    // element, since the latter is prone to ABA, and put back the rest
+    Dav1dMemPoolBuffer *const buf =
+        (Dav1dMemPoolBuffer *) atomic_exchange(&pool->buf, 0);
+    if (buf && buf->next) {
+        Dav1dMemPoolBuffer *last = buf->next;
+        while (last->next) last = last->next;
+        mem_pool_push_list(pool, buf->next, last);
+    }
+    return buf;
+}
+
+// free all buffers currently held by the pool
+static void mem_pool_drain(Dav1dMemPool *const pool) {
+    for (int i = 0; i < DAV1D_MEM_POOL_CACHE_SIZE; i++) {
+        Dav1dMemPoolBuffer *const buf = (Dav1dMemPoolBuffer *)
+            atomic_exchange(&pool->cache[i].buf, 0);
+        if (buf) dav1d_free_aligned(buf->data);
+    }
+    Dav1dMemPoolBuffer *buf = (Dav1dMemPoolBuffer *) atomic_exchange(&pool->buf, 0);
+    while (buf) {
+        void *const data = buf->data;
+        buf = buf->next;
+        dav1d_free_aligned(data);
+    }
 }
 
 void dav1d_mem_pool_push(Dav1dMemPool *const pool, Dav1dMemPoolBuffer *const buf) {
-    pthread_mutex_lock(&pool->lock);
-    const int ref_cnt = --pool->ref_cnt;
-    if (!pool->end) {
-        buf->next = pool->buf;
-        pool->buf = buf;
-        pthread_mutex_unlock(&pool->lock);
-        assert(ref_cnt > 0);
+    if (!atomic_load(&pool->end)) {
+        mem_pool_insert(pool, buf);
+        // dav1d_mem_pool_end() may have drained the pool before the buffer
+        // was inserted, in which case it's up to us to release it
+        if (atomic_load(&pool->end))
+            mem_pool_drain(pool);
     } else {
-        pthread_mutex_unlock(&pool->lock);
         dav1d_free_aligned(buf->data);
-        if (!ref_cnt) mem_pool_destroy(pool);
     }
+    if (atomic_fetch_sub(&pool->ref_cnt, 1) == 1)
+        mem_pool_destroy(pool);
 }
 
 Dav1dMemPoolBuffer *dav1d_mem_pool_pop(Dav1dMemPool *const pool, const size_t size) {
     assert(!(size & (sizeof(void*) - 1)));
-    pthread_mutex_lock(&pool->lock);
-    Dav1dMemPoolBuffer *buf = pool->buf;
-    pool->ref_cnt++;
+    atomic_fetch_add(&pool->ref_cnt, 1);
+    Dav1dMemPoolBuffer *buf = mem_pool_remove(pool);
     uint8_t *data;
     if (buf) {
-        pool->buf = buf->next;
-        pthread_mutex_unlock(&pool->lock);
         data = buf->data;
         if ((uintptr_t)buf - (uintptr_t)data != size) {
             /* Reallocate if the size has changed */
+            dav1d_trace2(pool_miss, pool, size);
             dav1d_free_aligned(data);
             goto alloc;
         }
@@ -269,15 +331,13 @@ Dav1dMemPoolBuffer *dav1d_mem_pool_pop(Dav1dMemPool *const pool, const size_t si
         dav1d_track_reuse(pool->type);
 #endif
     } else {
-        pthread_mutex_unlock(&pool->lock);
+        dav1d_trace2(pool_miss, pool, size);
 alloc:
         data = dav1d_alloc_aligned(pool->type,
                                    size + sizeof(Dav1dMemPoolBuffer), 64);
         if (!data) {
-            pthread_mutex_lock(&pool->lock);
-            const int ref_cnt = --pool->ref_cnt;
-            pthread_mutex_unlock(&pool->lock);
-            if (!ref_cnt) mem_pool_destroy(pool);
+            if (atomic_fetch_sub(&pool->ref_cnt, 1) == 1)
+                mem_pool_destroy(pool);
             return NULL;
         }
         buf = (Dav1dMemPoolBuffer*)(data + size);
@@ -290,20 +350,19 @@ alloc:
 COLD int dav1d_mem_pool_init(const enum AllocationType type,
                              Dav1dMemPool **const ppool)
 {
-    Dav1dMemPool *const pool = dav1d_malloc(ALLOC_COMMON_CTX,
-                                            sizeof(Dav1dMemPool));
+    Dav1dMemPool *const pool = dav1d_alloc_aligned(ALLOC_COMMON_CTX,
+                                                   sizeof(Dav1dMemPool), 64);
     if (pool) {
-        if (!pthread_mutex_init(&pool->lock, NULL)) {
-            pool->buf = NULL;
-            pool->ref_cnt = 1;
-            pool->end = 0;
+        for (int i = 0; i < DAV1D_MEM_POOL_CACHE_SIZE; i++)
+            atomic_init(&pool->cache[i].buf, 0);
+        atomic_init(&pool->buf, 0);
+        atomic_init(&pool->ref_cnt, 1);
+        atomic_init(&pool->end, 0);
 #if TRACK_HEAP_ALLOCATIONS
-            pool->type = type;
+        pool->type = type;
 #endif
-            *ppool = pool;
-            return 0;
-        }
-        dav1d_free(pool);
+        *ppool = pool;
+        return 0;
     }
     *ppool = NULL;
     return DAV1D_ERR(ENOMEM);
@@ -311,18 +370,9 @@ COLD int dav1d_mem_pool_init(const enum AllocationType type,
 
 COLD void dav1d_mem_pool_end(Dav1dMemPool *const pool) {
     if (pool) {
-        pthread_mutex_lock(&pool->lock);
-        Dav1dMemPoolBuffer *buf = pool->buf;
-        const int ref_cnt = --pool->ref_cnt;
-        pool->buf = NULL;
-        pool->end = 1;
-        pthread_mutex_unlock(&pool->lock);
-
-        while (buf) {
-            void *const data = buf->data;
-            buf = buf->next;
-            dav1d_free_aligned(data);
-        }
-        if (!ref_cnt) mem_pool_destroy(pool);
+        atomic_store(&pool->end, 1);
+        mem_pool_drain(pool);
+        if (atomic_fetch_sub(&pool->ref_cnt, 1) == 1)
+            mem_pool_destroy(pool);
     }
 }
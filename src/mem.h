@@ -30,6 +30,8 @@
 
 #define TRACK_HEAP_ALLOCATIONS 0
 
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #if defined(_WIN32) || !defined(HAVE_POSIX_MEMALIGN)
@@ -69,11 +71,22 @@ typedef struct Dav1dMemPoolBuffer {
     struct Dav1dMemPoolBuffer *next;
 } Dav1dMemPoolBuffer;
 
+#define DAV1D_MEM_POOL_CACHE_SIZE 8
+
+/*
+ * Lock-free buffer pool. Free buffers live in a few single-buffer cache
+ * slots, which each thread starts probing at a different index, and an
+ * overflow stack. Both are only ever updated using exchange or by
+ * compare-and-swap against a known head value without dereferencing it,
+ * so neither is subject to ABA.
+ */
 typedef struct Dav1dMemPool {
-    pthread_mutex_t lock;
-    Dav1dMemPoolBuffer *buf;
-    int ref_cnt;
-    int end;
+    struct {
+        ALIGN(atomic_uintptr_t buf, 64); // Dav1dMemPoolBuffer *
+    } cache[DAV1D_MEM_POOL_CACHE_SIZE];
+    ALIGN(atomic_uintptr_t buf, 64); // Dav1dMemPoolBuffer *, overflow stack
+    atomic_int ref_cnt;
+    atomic_int end;
 #if TRACK_HEAP_ALLOCATIONS
     enum AllocationType type;
 #endif
@@ -406,6 +406,14 @@ static const Dav1dLoopfilterModeRefDeltas default_mode_ref_deltas = {
     .ref_delta = { 1, 0, 0, 0, -1, 0, -1, -1 },
 };
 
+// whether every reference slot was set by a frame seen since the last flush
+static int refs_known(const Dav1dContext *const c) {
+    for (int i = 0; i < 8; i++)
+        if (!c->refs[i].p.p.frame_hdr)
+            return 0;
+    return 1;
+}
+
 static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb) {
 #define DEBUG_FRAME_HDR 0
 
@@ -1191,7 +1199,9 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb) {
     return 0;
 
 error:
-    dav1d_log(c, "Error parsing frame header\n");
+    // headers referring to slots we never saw are expected while resyncing
+    if (!c->resync || refs_known(c))
+        dav1d_log(c, "Error parsing frame header\n");
     return DAV1D_ERR(EINVAL);
 }
 
@@ -1210,6 +1220,39 @@ static void parse_tile_hdr(Dav1dContext *const c, GetBits *const gb) {
     }
 }
 
+// whether all references the frame depends on hold decoded pictures
+static int has_refs(const Dav1dContext *const c, const Dav1dFrameHeader *const hdr) {
+    if (hdr->primary_ref_frame != DAV1D_PRIMARY_REF_NONE &&
+        !c->refs[hdr->refidx[hdr->primary_ref_frame]].p.p.data[0])
+    {
+        return 0;
+    }
+    if (IS_INTER_OR_SWITCH(hdr))
+        for (int i = 0; i < 7; i++)
+            if (!c->refs[hdr->refidx[i]].p.p.data[0])
+                return 0;
+    return 1;
+}
+
+// whether the frame is excluded from decoding by c->decode_frame_type
+static int skip_frame_type(const Dav1dContext *const c,
+                           const Dav1dFrameHeader *const hdr)
+{
+    switch (hdr->frame_type) {
+    case DAV1D_FRAME_TYPE_INTER:
+    case DAV1D_FRAME_TYPE_SWITCH:
+        return c->decode_frame_type > DAV1D_DECODEFRAMETYPE_REFERENCE ||
+               (c->decode_frame_type == DAV1D_DECODEFRAMETYPE_REFERENCE &&
+                !hdr->refresh_frame_flags);
+    case DAV1D_FRAME_TYPE_INTRA:
+        return c->decode_frame_type > DAV1D_DECODEFRAMETYPE_INTRA ||
+               (c->decode_frame_type == DAV1D_DECODEFRAMETYPE_REFERENCE &&
+                !hdr->refresh_frame_flags);
+    default:
+        return 0;
+    }
+}
+
 ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
     GetBits gb;
     int res;
@@ -1310,7 +1353,10 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
         // fall-through
     case DAV1D_OBU_FRAME:
     case DAV1D_OBU_FRAME_HDR:
-        if (!c->seq_hdr) goto error;
+        if (!c->seq_hdr) {
+            if (c->resync) goto drop;
+            goto error;
+        }
         if (!c->frame_hdr_ref) {
             c->frame_hdr_ref = dav1d_ref_create_using_pool(c->frame_hdr_pool,
                                                            sizeof(Dav1dFrameHeader));
@@ -1326,6 +1372,15 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
         c->frame_hdr->spatial_id = spatial_id;
         if ((res = parse_frame_hdr(c, &gb)) < 0) {
             c->frame_hdr = NULL;
+            if (c->resync && !refs_known(c)) {
+                // the header most likely depends on a reference we haven't
+                // seen; since we can't tell which slots it refreshes, none
+                // of the references can be trusted anymore
+                for (int i = 0; i < 8; i++)
+                    if (c->refs[i].p.p.frame_hdr)
+                        dav1d_thread_picture_unref(&c->refs[i].p);
+                goto drop;
+            }
             goto error;
         }
         for (int n = 0; n < c->n_tile_data; n++)
@@ -1364,7 +1419,10 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
         dav1d_bytealign_get_bits(&gb);
         // fall-through
     case DAV1D_OBU_TILE_GRP: {
-        if (!c->frame_hdr) goto error;
+        if (!c->frame_hdr) {
+            if (c->resync) goto drop;
+            goto error;
+        }
         if (c->n_tile_data_alloc < c->n_tile_data + 1) {
             if ((c->n_tile_data + 1) > INT_MAX / (int)sizeof(*c->tile)) goto error;
             struct Dav1dTileGroup *tile = dav1d_realloc(ALLOC_TILE, c->tile,
@@ -1379,14 +1437,11 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
         dav1d_bytealign_get_bits(&gb);
         if (gb.error) goto error;
 
-        dav1d_data_ref(&c->tile[c->n_tile_data].data, in);
-        c->tile[c->n_tile_data].data.data = gb.ptr;
-        c->tile[c->n_tile_data].data.sz = (size_t)(gb.ptr_end - gb.ptr);
         // ensure tile groups are in order and sane, see 6.10.1
         if (c->tile[c->n_tile_data].start > c->tile[c->n_tile_data].end ||
             c->tile[c->n_tile_data].start != c->n_tiles)
         {
-            for (int i = 0; i <= c->n_tile_data; i++)
+            for (int i = 0; i < c->n_tile_data; i++)
                 dav1d_data_unref_internal(&c->tile[i].data);
             c->n_tile_data = 0;
             c->n_tiles = 0;
@@ -1394,6 +1449,12 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
         }
         c->n_tiles += 1 + c->tile[c->n_tile_data].end -
                           c->tile[c->n_tile_data].start;
+        // the tile payload of frames which won't be decoded is not retained
+        if (skip_frame_type(c, c->frame_hdr))
+            break;
+        dav1d_data_ref(&c->tile[c->n_tile_data].data, in);
+        c->tile[c->n_tile_data].data.data = gb.ptr;
+        c->tile[c->n_tile_data].data.sz = (size_t)(gb.ptr_end - gb.ptr);
         c->n_tile_data++;
         break;
     }
@@ -1570,6 +1631,10 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
 
     if (c->seq_hdr && c->frame_hdr) {
         if (c->frame_hdr->show_existing_frame) {
+            if (c->resync && !c->refs[c->frame_hdr->existing_frame_idx].p.p.data[0]) {
+                c->frame_hdr = NULL;
+                goto drop;
+            }
             if (!c->refs[c->frame_hdr->existing_frame_idx].p.p.frame_hdr) goto error;
             switch (c->refs[c->frame_hdr->existing_frame_idx].p.p.frame_hdr->frame_type) {
             case DAV1D_FRAME_TYPE_INTER:
@@ -1593,6 +1658,9 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
             if (c->n_fc == 1) {
                 dav1d_thread_picture_ref(&c->out,
                                          &c->refs[c->frame_hdr->existing_frame_idx].p);
+                // the dirty map is relative to what was shown before its decoding
+                dav1d_ref_dec(&c->out.p.dirty_map_ref);
+                c->out.p.dirty_map = NULL;
                 dav1d_picture_copy_props(&c->out.p,
                                          c->content_light, c->content_light_ref,
                                          c->mastering_display, c->mastering_display_ref,
@@ -1647,6 +1715,8 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
                 dav1d_thread_picture_ref(out_delayed,
                                          &c->refs[c->frame_hdr->existing_frame_idx].p);
                 out_delayed->visible = 1;
+                dav1d_ref_dec(&out_delayed->p.dirty_map_ref);
+                out_delayed->p.dirty_map = NULL;
                 dav1d_picture_copy_props(&out_delayed->p,
                                          c->content_light, c->content_light_ref,
                                          c->mastering_display, c->mastering_display_ref,
@@ -1659,6 +1729,8 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
 
                 pthread_mutex_unlock(&c->task_thread.lock);
             }
+            if (c->dirty_regions)
+                dav1d_dirty_map_shown(c, &c->refs[c->frame_hdr->existing_frame_idx].p.p);
             if (c->refs[c->frame_hdr->existing_frame_idx].p.p.frame_hdr->frame_type == DAV1D_FRAME_TYPE_KEY) {
                 const int r = c->frame_hdr->existing_frame_idx;
                 c->refs[r].p.showable = 0;
@@ -1681,23 +1753,11 @@ ptrdiff_t dav1d_parse_obus(Dav1dContext *const c, Dav1dData *const in) {
             }
             c->frame_hdr = NULL;
         } else if (c->n_tiles == c->frame_hdr->tiling.cols * c->frame_hdr->tiling.rows) {
-            switch (c->frame_hdr->frame_type) {
-            case DAV1D_FRAME_TYPE_INTER:
-            case DAV1D_FRAME_TYPE_SWITCH:
-                if (c->decode_frame_type > DAV1D_DECODEFRAMETYPE_REFERENCE ||
-                    (c->decode_frame_type == DAV1D_DECODEFRAMETYPE_REFERENCE &&
-                     !c->frame_hdr->refresh_frame_flags))
-                    goto skip;
-                break;
-            case DAV1D_FRAME_TYPE_INTRA:
-                if (c->decode_frame_type > DAV1D_DECODEFRAMETYPE_INTRA ||
-                    (c->decode_frame_type == DAV1D_DECODEFRAMETYPE_REFERENCE &&
-                     !c->frame_hdr->refresh_frame_flags))
-                    goto skip;
-                // fall-through
-            default:
-                break;
-            }
+            if (skip_frame_type(c, c->frame_hdr))
+                goto skip;
+            // skip without decoding tiles until all references are available
+            if (c->resync && !has_refs(c, c->frame_hdr))
+                goto skip;
             if (!c->n_tile_data)
                 goto error;
             if ((res = dav1d_submit_frame(c)) < 0)
@@ -1730,6 +1790,14 @@ skip:
 
     return gb.ptr_end - gb.ptr_start;
 
+drop:
+    // resynchronizing, ignore OBUs that can't be used yet
+    for (int n = 0; n < c->n_tile_data; n++)
+        dav1d_data_unref_internal(&c->tile[n].data);
+    c->n_tile_data = 0;
+    c->n_tiles = 0;
+    return gb.ptr_end - gb.ptr_start;
+
 error:
     dav1d_data_props_copy(&c->cached_error_props, &in->m);
     dav1d_log(c, gb.error ? "Overrun in OBU bit buffer\n" :
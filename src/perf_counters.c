@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2024, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "common/attributes.h"
+
+#include "src/perf_counters.h"
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static int read_counters(const Dav1dPerfThread *const p,
+                         uint64_t values[DAV1D_N_PERF_COUNTERS])
+{
+    // PERF_FORMAT_GROUP layout: { nr, value[nr] }
+    uint64_t buf[1 + DAV1D_N_PERF_COUNTERS];
+    const ssize_t sz = (1 + p->n) * sizeof(*buf);
+    if (read(p->fd[0], buf, sz) != sz || buf[0] != (uint64_t) p->n)
+        return -1;
+    memcpy(values, &buf[1], p->n * sizeof(*buf));
+    return 0;
+}
+
+COLD int dav1d_perf_thread_open(Dav1dPerfThread *const p) {
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+        enum Dav1dPerfCounterFlags flag;
+    } events[DAV1D_N_PERF_COUNTERS] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,
+          DAV1D_PERF_COUNTER_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,
+          DAV1D_PERF_COUNTER_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,
+          DAV1D_PERF_COUNTER_LLC_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+          DAV1D_PERF_COUNTER_STALLED_CYCLES },
+    };
+
+    // the sums are zeroed at allocation and may be read concurrently
+    unsigned available = 0;
+    p->n = 0;
+    for (int i = 0; i < DAV1D_N_PERF_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = !p->n;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        // measure the calling thread, on any cpu
+        const int fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1,
+                                     p->n ? p->fd[0] : -1, 0);
+        if (fd < 0) {
+            // the remaining counters can't be grouped without a leader
+            if (!p->n) return -1;
+            continue;
+        }
+        p->fd[p->n] = fd;
+        p->counter[p->n] = events[i].flag;
+        available |= events[i].flag;
+        p->n++;
+    }
+    if (ioctl(p->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0) {
+        dav1d_perf_thread_close(p);
+        return -1;
+    }
+    atomic_store(&p->available, available);
+    return 0;
+}
+
+COLD void dav1d_perf_thread_close(Dav1dPerfThread *const p) {
+    for (int i = p->n - 1; i >= 0; i--)
+        close(p->fd[i]);
+    p->n = 0;
+    atomic_store(&p->available, 0);
+}
+
+void dav1d_perf_thread_start(Dav1dPerfThread *const p) {
+    if (read_counters(p, p->last))
+        memset(p->last, 0, sizeof(p->last));
+}
+
+void dav1d_perf_thread_sample(Dav1dPerfThread *const p,
+                              const enum Dav1dPerfTaskType type)
+{
+    uint64_t now[DAV1D_N_PERF_COUNTERS];
+    if (read_counters(p, now)) return;
+
+    Dav1dPerfSum *const sum = &p->sum[type];
+    for (int i = 0; i < p->n; i++) {
+        atomic_ullong *dst;
+        switch (p->counter[i]) {
+        case DAV1D_PERF_COUNTER_CYCLES:         dst = &sum->cycles; break;
+        case DAV1D_PERF_COUNTER_INSTRUCTIONS:   dst = &sum->instructions; break;
+        case DAV1D_PERF_COUNTER_LLC_MISSES:     dst = &sum->llc_misses; break;
+        default:                                dst = &sum->stalled_cycles; break;
+        }
+        atomic_fetch_add_explicit(dst, now[i] - p->last[i], memory_order_relaxed);
+        p->last[i] = now[i];
+    }
+    atomic_fetch_add_explicit(&sum->runs, 1, memory_order_relaxed);
+}
+
+void dav1d_perf_thread_add(const Dav1dPerfThread *const p,
+                           Dav1dPerfCounters *const out)
+{
+    out->available &= atomic_load(&p->available);
+    for (int i = 0; i < DAV1D_N_PERF_TASK_TYPES; i++) {
+        Dav1dTaskPerfCounters *const dst = &out->task[i];
+        const Dav1dPerfSum *const src = &p->sum[i];
+        dst->runs += atomic_load_explicit(&src->runs, memory_order_relaxed);
+        dst->cycles += atomic_load_explicit(&src->cycles, memory_order_relaxed);
+        dst->instructions +=
+            atomic_load_explicit(&src->instructions, memory_order_relaxed);
+        dst->llc_misses +=
+            atomic_load_explicit(&src->llc_misses, memory_order_relaxed);
+        dst->stalled_cycles +=
+            atomic_load_explicit(&src->stalled_cycles, memory_order_relaxed);
+    }
+}
+#else
+COLD int dav1d_perf_thread_open(Dav1dPerfThread *const p) {
+    p->n = 0;
+    return -1;
+}
+
+COLD void dav1d_perf_thread_close(Dav1dPerfThread *const p) {
+    p->n = 0;
+}
+
+void dav1d_perf_thread_start(Dav1dPerfThread *const p) {
+}
+
+void dav1d_perf_thread_sample(Dav1dPerfThread *const p,
+                              const enum Dav1dPerfTaskType type)
+{
+}
+
+void dav1d_perf_thread_add(const Dav1dPerfThread *const p,
+                           Dav1dPerfCounters *const out)
+{
+    out->available = 0;
+}
+#endif
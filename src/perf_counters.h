@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2024, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DAV1D_SRC_PERF_COUNTERS_H
+#define DAV1D_SRC_PERF_COUNTERS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "dav1d/dav1d.h"
+
+#define DAV1D_N_PERF_COUNTERS 4
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+/* Counter deltas accumulated for one task type. Only the owning thread
+ * updates them, other threads read them with relaxed loads. */
+typedef struct Dav1dPerfSum {
+    atomic_ullong runs;
+    atomic_ullong cycles;
+    atomic_ullong instructions;
+    atomic_ullong llc_misses;
+    atomic_ullong stalled_cycles;
+} Dav1dPerfSum;
+#endif
+
+/* Hardware performance counters of a single thread, and their deltas
+ * accumulated per task type. Only the owning thread reads the counters and
+ * updates the sums, available and sum can be read from any thread. */
+typedef struct Dav1dPerfThread {
+    int n; // number of opened counters, 0 if disabled
+    int fd[DAV1D_N_PERF_COUNTERS]; // fd[0] is the group leader
+    uint8_t counter[DAV1D_N_PERF_COUNTERS]; // enum Dav1dPerfCounterFlags bit of fd[i]
+    atomic_uint available; // mask of enum Dav1dPerfCounterFlags
+    uint64_t last[DAV1D_N_PERF_COUNTERS];
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    Dav1dPerfSum sum[DAV1D_N_PERF_TASK_TYPES];
+#endif
+} Dav1dPerfThread;
+
+/* Open counters for the calling thread. Returns 0 on success, or a negative
+ * value if no counter could be opened, in which case p->n is 0. */
+int dav1d_perf_thread_open(Dav1dPerfThread *p);
+void dav1d_perf_thread_close(Dav1dPerfThread *p);
+
+/* Snapshot the counters at the start of a task. */
+void dav1d_perf_thread_start(Dav1dPerfThread *p);
+
+/* Attribute the counter deltas since the last snapshot to the given task
+ * type, and take a new snapshot. */
+void dav1d_perf_thread_sample(Dav1dPerfThread *p, enum Dav1dPerfTaskType type);
+
+/* Add the sums of a thread to out. Safe to call while the thread runs. */
+void dav1d_perf_thread_add(const Dav1dPerfThread *p, Dav1dPerfCounters *out);
+
+#endif /* DAV1D_SRC_PERF_COUNTERS_H */
@@ -206,6 +206,16 @@ int dav1d_thread_picture_alloc(Dav1dContext *const c, Dav1dFrameContext *const f
                              c->itut_t35, c->itut_t35_ref, c->n_itut_t35,
                              &f->tile[0].data.m);
 
+    p->p.decode_stats = f->stats.data;
+    p->p.decode_stats_ref = f->stats.ref;
+    if (f->stats.ref) dav1d_ref_inc(f->stats.ref);
+    p->p.block_info = f->block_info.data;
+    p->p.block_info_ref = f->block_info.ref;
+    if (f->block_info.ref) dav1d_ref_inc(f->block_info.ref);
+    p->p.dirty_map = f->dirty.data;
+    p->p.dirty_map_ref = f->dirty.ref;
+    if (f->dirty.ref) dav1d_ref_inc(f->dirty.ref);
+
     // Must be removed from the context after being attached to the frame
     dav1d_ref_dec(&c->itut_t35_ref);
     c->itut_t35 = NULL;
@@ -245,6 +255,16 @@ int dav1d_picture_alloc_copy(Dav1dContext *const c, Dav1dPicture *const dst, con
                              src->itut_t35, src->itut_t35_ref, src->n_itut_t35,
                              &src->m);
 
+    dst->decode_stats = src->decode_stats;
+    dst->decode_stats_ref = src->decode_stats_ref;
+    if (src->decode_stats_ref) dav1d_ref_inc(src->decode_stats_ref);
+    dst->block_info = src->block_info;
+    dst->block_info_ref = src->block_info_ref;
+    if (src->block_info_ref) dav1d_ref_inc(src->block_info_ref);
+    dst->dirty_map = src->dirty_map;
+    dst->dirty_map_ref = src->dirty_map_ref;
+    if (src->dirty_map_ref) dav1d_ref_inc(src->dirty_map_ref);
+
     return 0;
 }
 
@@ -263,6 +283,9 @@ void dav1d_picture_ref(Dav1dPicture *const dst, const Dav1dPicture *const src) {
     if (src->content_light_ref) dav1d_ref_inc(src->content_light_ref);
     if (src->mastering_display_ref) dav1d_ref_inc(src->mastering_display_ref);
     if (src->itut_t35_ref) dav1d_ref_inc(src->itut_t35_ref);
+    if (src->decode_stats_ref) dav1d_ref_inc(src->decode_stats_ref);
+    if (src->block_info_ref) dav1d_ref_inc(src->block_info_ref);
+    if (src->dirty_map_ref) dav1d_ref_inc(src->dirty_map_ref);
     *dst = *src;
 }
 
@@ -312,6 +335,9 @@ void dav1d_picture_unref_internal(Dav1dPicture *const p) {
     dav1d_ref_dec(&p->content_light_ref);
     dav1d_ref_dec(&p->mastering_display_ref);
     dav1d_ref_dec(&p->itut_t35_ref);
+    dav1d_ref_dec(&p->decode_stats_ref);
+    dav1d_ref_dec(&p->block_info_ref);
+    dav1d_ref_dec(&p->dirty_map_ref);
     memset(p, 0, sizeof(*p));
     dav1d_data_props_set_defaults(&p->m);
 }
@@ -27,6 +27,7 @@
 
 #include "config.h"
 
+#include <limits.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -720,9 +721,22 @@ static int decode_coefs(Dav1dTaskContext *const t,
     // context
     *res_ctx = umin(cul_level, 63) | dc_sign_level;
 
+    if (f->c->count_work) t->n_coefs += eob + 1;
     return eob;
 }
 
+// With luma_only (chroma) and entropy_only (all planes), coefficients are
+// decoded but not inverse transformed, so clear them here as itxfm_add()
+// would have done.
+static inline void clear_coefs(coef *const cf, const int eob,
+                               const TxfmInfo *const t_dim)
+{
+    if (eob)
+        memset(cf, 0, sizeof(*cf) * imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16);
+    else
+        cf[0] = 0;
+}
+
 static void read_coef_tree(Dav1dTaskContext *const t,
                            const enum BlockSize bs, const Av1Block *const b,
                            const enum RectTxfmSize ytx, const int depth,
@@ -809,8 +823,10 @@ static void read_coef_tree(Dav1dTaskContext *const t,
             txtp = cbi & 0x1f;
         }
         if (!(t->frame_thread.pass & 1)) {
-            assert(dst);
-            if (eob >= 0) {
+            if (!dst) {
+                assert(f->c->entropy_only);
+                if (eob >= 0) clear_coefs(cf, eob, t_dim);
+            } else if (eob >= 0) {
                 if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                     coef_dump(cf, imin(t_dim->h, 8) * 4, imin(t_dim->w, 8) * 4, 3, "dq");
                 dsp->itx.itxfm_add[ytx][txtp](dst, f->cur.stride[0], cf, eob
@@ -857,7 +873,10 @@ void bytefn(dav1d_read_coef_blocks)(Dav1dTaskContext *const t,
     Dav1dTileState *const ts = t->ts;
     const int w4 = imin(bw4, f->bw - t->bx), h4 = imin(bh4, f->bh - t->by);
     const int cw4 = (w4 + ss_hor) >> ss_hor, ch4 = (h4 + ss_ver) >> ss_ver;
-    assert(t->frame_thread.pass == 1);
+    // without frame threading, this is only used by entropy_only, in which
+    // case the coefficients are decoded into t->cf and discarded
+    const int pass = t->frame_thread.pass;
+    assert(pass == 1 || (!pass && f->c->entropy_only));
     assert(!b->skip);
     const TxfmInfo *const uv_t_dim = &dav1d_txfm_dimensions[b->uvtx];
     const TxfmInfo *const t_dim = &dav1d_txfm_dimensions[b->intra ? b->tx : b->max_ytx];
@@ -881,15 +900,20 @@ void bytefn(dav1d_read_coef_blocks)(Dav1dTaskContext *const t,
                     } else {
                         uint8_t cf_ctx = 0x40;
                         enum TxfmType txtp;
+                        coef *const cf = pass ? ts->frame_thread[1].cf : bitfn(t->cf);
                         const int eob =
                             decode_coefs(t, &t->a->lcoef[bx4 + x],
                                          &t->l.lcoef[by4 + y], b->tx, bs, b, 1,
-                                         0, ts->frame_thread[1].cf, &txtp, &cf_ctx);
+                                         0, cf, &txtp, &cf_ctx);
                         if (DEBUG_BLOCK_INFO)
                             printf("Post-y-cf-blk[tx=%d,txtp=%d,eob=%d]: r=%d\n",
                                    b->tx, txtp, eob, ts->msac.rng);
-                        *ts->frame_thread[1].cbi++ = eob * (1 << 5) + txtp;
-                        ts->frame_thread[1].cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
+                        if (pass) {
+                            *ts->frame_thread[1].cbi++ = eob * (1 << 5) + txtp;
+                            ts->frame_thread[1].cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
+                        } else if (eob >= 0) {
+                            clear_coefs(cf, eob, t_dim);
+                        }
 #define set_ctx(type, dir, diridx, off, mul, rep_macro) \
                         rep_macro(type, t->dir lcoef, off, mul * cf_ctx)
 #define default_memset(dir, diridx, off, sz) \
@@ -922,17 +946,21 @@ void bytefn(dav1d_read_coef_blocks)(Dav1dTaskContext *const t,
                         if (!b->intra)
                             txtp = t->scratch.txtp_map[(by4 + (y << ss_ver)) * 32 +
                                                         bx4 + (x << ss_hor)];
+                        coef *const cf = pass ? ts->frame_thread[1].cf : bitfn(t->cf);
                         const int eob =
                             decode_coefs(t, &t->a->ccoef[pl][cbx4 + x],
                                          &t->l.ccoef[pl][cby4 + y], b->uvtx, bs,
-                                         b, b->intra, 1 + pl, ts->frame_thread[1].cf,
-                                         &txtp, &cf_ctx);
+                                         b, b->intra, 1 + pl, cf, &txtp, &cf_ctx);
                         if (DEBUG_BLOCK_INFO)
                             printf("Post-uv-cf-blk[pl=%d,tx=%d,"
                                    "txtp=%d,eob=%d]: r=%d\n",
                                    pl, b->uvtx, txtp, eob, ts->msac.rng);
-                        *ts->frame_thread[1].cbi++ = eob * (1 << 5) + txtp;
-                        ts->frame_thread[1].cf += uv_t_dim->w * uv_t_dim->h * 16;
+                        if (pass) {
+                            *ts->frame_thread[1].cbi++ = eob * (1 << 5) + txtp;
+                            ts->frame_thread[1].cf += uv_t_dim->w * uv_t_dim->h * 16;
+                        } else if (eob >= 0) {
+                            clear_coefs(cf, eob, uv_t_dim);
+                        }
 #define set_ctx(type, dir, diridx, off, mul, rep_macro) \
                         rep_macro(type, t->dir ccoef[pl], off, mul * cf_ctx)
 #define default_memset(dir, diridx, off, sz) \
@@ -1068,6 +1096,86 @@ static int mc(Dav1dTaskContext *const t,
     return 0;
 }
 
+typedef struct ObmcStrip {
+    int pos4, len4; // offset and length along the block edge, in 4px units
+    const refmvs_block *r;
+    enum Filter2d filter;
+} ObmcStrip;
+
+static inline int is_pow2(const int v) {
+    return !(v & (v - 1));
+}
+
+// Predicts and blends the overlapping strips collected along one block edge.
+// Adjacent strips are laid out next to each other in the lap buffer so that
+// a run of them is blended in one call, and neighbours sharing the same
+// motion are predicted together. Runs are only extended as long as their
+// total length stays a power of two, which is what the mc/blend DSP
+// functions are implemented for.
+static int obmc_strips(Dav1dTaskContext *const t,
+                       pixel *const dst, const ptrdiff_t dst_stride,
+                       const ObmcStrip *const s, const int n, const int pl,
+                       const int left, const int ext4)
+{
+    const Dav1dFrameContext *const f = t->f;
+    pixel *const lap = bitfn(t->scratch.lap);
+    const int ss_ver = !!pl && f->cur.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = !!pl && f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I444;
+    const int h_mul = 4 >> ss_hor, v_mul = 4 >> ss_ver;
+
+    for (int i = 0, j; i < n; i = j) {
+        int len4 = s[i].len4;
+        for (j = i + 1; j < n && s[j].pos4 == s[j - 1].pos4 + s[j - 1].len4 &&
+                        is_pow2(len4 + s[j].len4); j++)
+        {
+            len4 += s[j].len4;
+        }
+
+        const ptrdiff_t lap_stride = (left ? ext4 : len4) * h_mul;
+        for (int k = i, l; k < j; k = l) {
+            const refmvs_block *const r = s[k].r;
+            const int refidx = r->ref.ref[0] - 1;
+            const Dav1dThreadPicture *const refp = &f->refp[refidx];
+            // scaled references position each block independently, and the
+            // subpel filters are reduced to 4 taps for sizes <= 4, so merging
+            // is only bit-exact for unscaled references and larger strips
+            const int mul = left ? v_mul : h_mul;
+            const int can_merge = refp->p.p.w == f->cur.p.w &&
+                                  refp->p.p.h == f->cur.p.h &&
+                                  s[k].len4 * mul > 4;
+            int mlen4 = s[k].len4;
+            for (l = k + 1; l < j && can_merge && s[l].len4 * mul > 4 &&
+                            s[l].r->ref.ref[0] == r->ref.ref[0] &&
+                            s[l].r->mv.mv[0].n == r->mv.mv[0].n &&
+                            s[l].filter == s[k].filter &&
+                            is_pow2(mlen4 + s[l].len4); l++)
+            {
+                mlen4 += s[l].len4;
+            }
+
+            const int off4 = s[k].pos4 - s[i].pos4;
+            const int res = left ?
+                mc(t, &lap[off4 * v_mul * lap_stride], NULL,
+                   lap_stride * sizeof(pixel), ext4, mlen4,
+                   t->bx, t->by + s[k].pos4, pl, r->mv.mv[0],
+                   refp, refidx, s[k].filter) :
+                mc(t, &lap[off4 * h_mul], NULL,
+                   lap_stride * sizeof(pixel), mlen4, (ext4 * 3 + 3) >> 2,
+                   t->bx + s[k].pos4, t->by, pl, r->mv.mv[0],
+                   refp, refidx, s[k].filter);
+            if (res) return res;
+        }
+
+        if (left)
+            f->dsp->mc.blend_v(&dst[s[i].pos4 * v_mul * PXSTRIDE(dst_stride)],
+                               dst_stride, lap, h_mul * ext4, v_mul * len4);
+        else
+            f->dsp->mc.blend_h(&dst[s[i].pos4 * h_mul], dst_stride, lap,
+                               h_mul * len4, v_mul * ext4);
+    }
+    return 0;
+}
+
 static int obmc(Dav1dTaskContext *const t,
                 pixel *const dst, const ptrdiff_t dst_stride,
                 const uint8_t *const b_dim, const int pl,
@@ -1076,61 +1184,76 @@ static int obmc(Dav1dTaskContext *const t,
     assert(!(t->bx & 1) && !(t->by & 1));
     const Dav1dFrameContext *const f = t->f;
     /*const*/ refmvs_block **r = &t->rt.r[(t->by & 31) + 5];
-    pixel *const lap = bitfn(t->scratch.lap);
     const int ss_ver = !!pl && f->cur.p.layout == DAV1D_PIXEL_LAYOUT_I420;
     const int ss_hor = !!pl && f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I444;
     const int h_mul = 4 >> ss_hor, v_mul = 4 >> ss_ver;
-    int res;
+    ObmcStrip strips[4];
+    int n, res;
 
     if (t->by > t->ts->tiling.row_start &&
         (!pl || b_dim[0] * h_mul + b_dim[1] * v_mul >= 16))
     {
-        for (int i = 0, x = 0; x < w4 && i < imin(b_dim[2], 4); ) {
+        n = 0;
+        for (int x = 0; x < w4 && n < imin(b_dim[2], 4); ) {
             // only odd blocks are considered for overlap handling, hence +1
             const refmvs_block *const a_r = &r[-1][t->bx + x + 1];
             const uint8_t *const a_b_dim = dav1d_block_dimensions[a_r->bs];
             const int step4 = iclip(a_b_dim[0], 2, 16);
 
             if (a_r->ref.ref[0] > 0) {
-                const int ow4 = imin(step4, b_dim[0]);
-                const int oh4 = imin(b_dim[1], 16) >> 1;
-                res = mc(t, lap, NULL, ow4 * h_mul * sizeof(pixel), ow4, (oh4 * 3 + 3) >> 2,
-                         t->bx + x, t->by, pl, a_r->mv.mv[0],
-                         &f->refp[a_r->ref.ref[0] - 1], a_r->ref.ref[0] - 1,
-                         dav1d_filter_2d[t->a->filter[1][bx4 + x + 1]][t->a->filter[0][bx4 + x + 1]]);
-                if (res) return res;
-                f->dsp->mc.blend_h(&dst[x * h_mul], dst_stride, lap,
-                                   h_mul * ow4, v_mul * oh4);
-                i++;
+                strips[n++] = (ObmcStrip) {
+                    .pos4 = x, .len4 = imin(step4, b_dim[0]), .r = a_r,
+                    .filter = dav1d_filter_2d[t->a->filter[1][bx4 + x + 1]]
+                                             [t->a->filter[0][bx4 + x + 1]],
+                };
             }
             x += step4;
         }
+        res = obmc_strips(t, dst, dst_stride, strips, n, pl, 0,
+                          imin(b_dim[1], 16) >> 1);
+        if (res) return res;
     }
 
-    if (t->bx > t->ts->tiling.col_start)
-        for (int i = 0, y = 0; y < h4 && i < imin(b_dim[3], 4); ) {
+    if (t->bx > t->ts->tiling.col_start) {
+        n = 0;
+        for (int y = 0; y < h4 && n < imin(b_dim[3], 4); ) {
             // only odd blocks are considered for overlap handling, hence +1
             const refmvs_block *const l_r = &r[y + 1][t->bx - 1];
             const uint8_t *const l_b_dim = dav1d_block_dimensions[l_r->bs];
             const int step4 = iclip(l_b_dim[1], 2, 16);
 
             if (l_r->ref.ref[0] > 0) {
-                const int ow4 = imin(b_dim[0], 16) >> 1;
-                const int oh4 = imin(step4, b_dim[1]);
-                res = mc(t, lap, NULL, h_mul * ow4 * sizeof(pixel), ow4, oh4,
-                         t->bx, t->by + y, pl, l_r->mv.mv[0],
-                         &f->refp[l_r->ref.ref[0] - 1], l_r->ref.ref[0] - 1,
-                         dav1d_filter_2d[t->l.filter[1][by4 + y + 1]][t->l.filter[0][by4 + y + 1]]);
-                if (res) return res;
-                f->dsp->mc.blend_v(&dst[y * v_mul * PXSTRIDE(dst_stride)],
-                                   dst_stride, lap, h_mul * ow4, v_mul * oh4);
-                i++;
+                strips[n++] = (ObmcStrip) {
+                    .pos4 = y, .len4 = imin(step4, b_dim[1]), .r = l_r,
+                    .filter = dav1d_filter_2d[t->l.filter[1][by4 + y + 1]]
+                                             [t->l.filter[0][by4 + y + 1]],
+                };
             }
             y += step4;
         }
+        res = obmc_strips(t, dst, dst_stride, strips, n, pl, 1,
+                          imin(b_dim[0], 16) >> 1);
+        if (res) return res;
+    }
     return 0;
 }
 
+static inline void warp_affine_pos(const Dav1dTaskContext *const t,
+                                   const int32_t *const mat,
+                                   const int ss_hor, const int ss_ver,
+                                   const int x, const int y,
+                                   int64_t *const mvx, int64_t *const mvy)
+{
+    // calculate transformation relative to center of 8x8 block in
+    // luma pixel units
+    const int src_x = t->bx * 4 + ((x + 4) << ss_hor);
+    const int src_y = t->by * 4 + ((y + 4) << ss_ver);
+    const int64_t mat3_y = (int64_t) mat[3] * src_y + mat[0];
+    const int64_t mat5_y = (int64_t) mat[5] * src_y + mat[1];
+    *mvx = ((int64_t) mat[2] * src_x + mat3_y) >> ss_hor;
+    *mvy = ((int64_t) mat[4] * src_x + mat5_y) >> ss_ver;
+}
+
 static int warp_affine(Dav1dTaskContext *const t,
                        pixel *dst8, int16_t *dst16, const ptrdiff_t dstride,
                        const uint8_t *const b_dim, const int pl,
@@ -1147,17 +1270,61 @@ static int warp_affine(Dav1dTaskContext *const t,
     const int32_t *const mat = wmp->matrix;
     const int width = (refp->p.p.w + ss_hor) >> ss_hor;
     const int height = (refp->p.p.h + ss_ver) >> ss_ver;
+    const int bw = b_dim[0] * h_mul, bh = b_dim[1] * v_mul;
+    pixel *const emu_edge_buf = bitfn(t->scratch.emu_edge);
+
+    // The source position is a linear function of the 8x8 block position,
+    // so the area read by the whole block is bounded by its corner 8x8
+    // blocks. If that area crosses the picture edge, emulate the edges once
+    // for the whole block, unless only a few 8x8 blocks cross it and
+    // emulating their 15x15 areas separately copies fewer pixels.
+    int dx_min = INT_MAX, dx_max = INT_MIN, dy_min = INT_MAX, dy_max = INT_MIN;
+    for (int i = 0; i < 4; i++) {
+        int64_t mvx, mvy;
+        warp_affine_pos(t, mat, ss_hor, ss_ver, i & 1 ? bw - 8 : 0,
+                        i & 2 ? bh - 8 : 0, &mvx, &mvy);
+        const int dx = (int) (mvx >> 16) - 4, dy = (int) (mvy >> 16) - 4;
+        dx_min = imin(dx_min, dx);
+        dx_max = imax(dx_max, dx);
+        dy_min = imin(dy_min, dy);
+        dy_max = imax(dy_max, dy);
+    }
+    const pixel *ref = refp->p.data[pl];
+    ptrdiff_t ref_stride = refp->p.stride[!!pl];
+    int ref_x = 0, ref_y = 0, emu_edge_8x8 = 0;
+    if (dx_min < 3 || dx_max + 8 + 4 > width || dy_min < 3 || dy_max + 8 + 4 > height) {
+        const int ew = dx_max - dx_min + 15, eh = dy_max - dy_min + 15;
+        int n_cross = 0;
+        if (ew <= 320 && eh <= 256 + 7) {
+            for (int y = 0; y < bh; y += 8)
+                for (int x = 0; x < bw; x += 8) {
+                    int64_t mvx, mvy;
+                    warp_affine_pos(t, mat, ss_hor, ss_ver, x, y, &mvx, &mvy);
+                    const int dx = (int) (mvx >> 16) - 4;
+                    const int dy = (int) (mvy >> 16) - 4;
+                    n_cross += dx < 3 || dx + 8 + 4 > width ||
+                               dy < 3 || dy + 8 + 4 > height;
+                }
+        }
+        if (n_cross * 15 * 15 >= ew * eh) {
+            f->dsp->mc.emu_edge(ew, eh, width, height, dx_min - 3, dy_min - 3,
+                                emu_edge_buf, 320 * sizeof(pixel),
+                                ref, ref_stride);
+            ref = emu_edge_buf;
+            ref_stride = 320 * sizeof(pixel);
+            ref_x = dx_min - 3;
+            ref_y = dy_min - 3;
+        } else {
+            // few 8x8 blocks cross the edge, or the block is so strongly
+            // warped that its source area does not fit the buffer
+            emu_edge_8x8 = 1;
+        }
+    }
 
-    for (int y = 0; y < b_dim[1] * v_mul; y += 8) {
-        const int src_y = t->by * 4 + ((y + 4) << ss_ver);
-        const int64_t mat3_y = (int64_t) mat[3] * src_y + mat[0];
-        const int64_t mat5_y = (int64_t) mat[5] * src_y + mat[1];
-        for (int x = 0; x < b_dim[0] * h_mul; x += 8) {
-            // calculate transformation relative to center of 8x8 block in
-            // luma pixel units
-            const int src_x = t->bx * 4 + ((x + 4) << ss_hor);
-            const int64_t mvx = ((int64_t) mat[2] * src_x + mat3_y) >> ss_hor;
-            const int64_t mvy = ((int64_t) mat[4] * src_x + mat5_y) >> ss_ver;
+    for (int y = 0; y < bh; y += 8) {
+        for (int x = 0; x < bw; x += 8) {
+            int64_t mvx, mvy;
+            warp_affine_pos(t, mat, ss_hor, ss_ver, x, y, &mvx, &mvy);
 
             const int dx = (int) (mvx >> 16) - 4;
             const int mx = (((int) mvx & 0xffff) - wmp->u.p.alpha * 4 -
@@ -1167,23 +1334,24 @@ static int warp_affine(Dav1dTaskContext *const t,
                                                    wmp->u.p.delta * 4) & ~0x3f;
 
             const pixel *ref_ptr;
-            ptrdiff_t ref_stride = refp->p.stride[!!pl];
+            ptrdiff_t ref_ptr_stride = ref_stride;
 
-            if (dx < 3 || dx + 8 + 4 > width || dy < 3 || dy + 8 + 4 > height) {
-                pixel *const emu_edge_buf = bitfn(t->scratch.emu_edge);
+            if (emu_edge_8x8 &&
+                (dx < 3 || dx + 8 + 4 > width || dy < 3 || dy + 8 + 4 > height))
+            {
                 f->dsp->mc.emu_edge(15, 15, width, height, dx - 3, dy - 3,
                                     emu_edge_buf, 32 * sizeof(pixel),
-                                    refp->p.data[pl], ref_stride);
+                                    ref, ref_stride);
                 ref_ptr = &emu_edge_buf[32 * 3 + 3];
-                ref_stride = 32 * sizeof(pixel);
+                ref_ptr_stride = 32 * sizeof(pixel);
             } else {
-                ref_ptr = ((pixel *) refp->p.data[pl]) + PXSTRIDE(ref_stride) * dy + dx;
+                ref_ptr = ref + PXSTRIDE(ref_stride) * (dy - ref_y) + (dx - ref_x);
             }
             if (dst16 != NULL)
-                dsp->mc.warp8x8t(&dst16[x], dstride, ref_ptr, ref_stride,
+                dsp->mc.warp8x8t(&dst16[x], dstride, ref_ptr, ref_ptr_stride,
                                  wmp->u.abcd, mx, my HIGHBD_CALL_SUFFIX);
             else
-                dsp->mc.warp8x8(&dst8[x], dstride, ref_ptr, ref_stride,
+                dsp->mc.warp8x8(&dst8[x], dstride, ref_ptr, ref_ptr_stride,
                                 wmp->u.abcd, mx, my HIGHBD_CALL_SUFFIX);
         }
         if (dst8) dst8  += 8 * PXSTRIDE(dstride);
@@ -1369,7 +1537,11 @@ void bytefn(dav1d_recon_b_intra)(Dav1dTaskContext *const t, const enum BlockSize
 
             const ptrdiff_t stride = f->cur.stride[1];
 
-            if (b->uv_mode == CFL_PRED) {
+            if (f->c->luma_only) {
+                // only keep the frame threading palette indices in sync
+                if (b->pal_sz[1] && t->frame_thread.pass)
+                    ts->frame_thread[t->frame_thread.pass & 1].pal_idx += cbw4 * cbh4 * 8;
+            } else if (b->uv_mode == CFL_PRED) {
                 assert(!init_x && !init_y);
 
                 int16_t *const ac = t->scratch.ac;
@@ -1473,7 +1645,7 @@ void bytefn(dav1d_recon_b_intra)(Dav1dTaskContext *const t, const enum BlockSize
                          x += uv_t_dim->w, t->bx += uv_t_dim->w << ss_hor)
                     {
                         if ((b->uv_mode == CFL_PRED && b->cfl_alpha[pl]) ||
-                            b->pal_sz[1])
+                            b->pal_sz[1] || f->c->luma_only)
                         {
                             goto skip_uv_pred;
                         }
@@ -1567,7 +1739,9 @@ void bytefn(dav1d_recon_b_intra)(Dav1dTaskContext *const t, const enum BlockSize
 #undef default_memset
 #undef set_ctx
                             }
-                            if (eob >= 0) {
+                            if (eob >= 0 && f->c->luma_only) {
+                                clear_coefs(cf, eob, uv_t_dim);
+                            } else if (eob >= 0) {
                                 if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                                     coef_dump(cf, uv_t_dim->h * 4,
                                               uv_t_dim->w * 4, 3, "dq");
@@ -1627,7 +1801,7 @@ int bytefn(dav1d_recon_b_inter)(Dav1dTaskContext *const t, const enum BlockSize
         res = mc(t, dst, NULL, f->cur.stride[0], bw4, bh4, t->bx, t->by, 0,
                  b->mv[0], &f->sr_cur, 0 /* unused */, FILTER_2D_BILINEAR);
         if (res) return res;
-        if (has_chroma) for (int pl = 1; pl < 3; pl++) {
+        if (has_chroma && !f->c->luma_only) for (int pl = 1; pl < 3; pl++) {
             res = mc(t, ((pixel *)f->cur.data[pl]) + uvdstoff, NULL, f->cur.stride[1],
                      bw4 << (bw4 == ss_hor), bh4 << (bh4 == ss_ver),
                      t->bx & ~ss_hor, t->by & ~ss_ver, pl, b->mv[0],
@@ -1680,7 +1854,7 @@ int bytefn(dav1d_recon_b_inter)(Dav1dTaskContext *const t, const enum BlockSize
                           bw4 * 4, bh4 * 4, II_MASK(0, bs, b));
         }
 
-        if (!has_chroma) goto skip_inter_chroma_pred;
+        if (!has_chroma || f->c->luma_only) goto skip_inter_chroma_pred;
 
         // sub8x8 derivation
         int is_sub8x8 = bw4 == ss_hor || bh4 == ss_ver;
@@ -1868,7 +2042,7 @@ int bytefn(dav1d_recon_b_inter)(Dav1dTaskContext *const t, const enum BlockSize
         }
 
         // chroma
-        if (has_chroma) for (int pl = 0; pl < 2; pl++) {
+        if (has_chroma && !f->c->luma_only) for (int pl = 0; pl < 2; pl++) {
             for (int i = 0; i < 2; i++) {
                 const Dav1dThreadPicture *const refp = &f->refp[b->ref[i]];
                 if (b->inter_mode == GLOBALMV_GLOBALMV &&
@@ -2011,7 +2185,9 @@ int bytefn(dav1d_recon_b_inter)(Dav1dTaskContext *const t, const enum BlockSize
 #undef default_memset
 #undef set_ctx
                         }
-                        if (eob >= 0) {
+                        if (eob >= 0 && f->c->luma_only) {
+                            clear_coefs(cf, eob, uvtx);
+                        } else if (eob >= 0) {
                             if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                                 coef_dump(cf, uvtx->h * 4, uvtx->w * 4, 3, "dq");
                             dsp->itx.itxfm_add[b->uvtx]
@@ -2115,7 +2291,8 @@ void bytefn(dav1d_filter_sbrow_resize)(Dav1dFrameContext *const f, const int sby
         f->lf.sr_p[1] + (y * PXSTRIDE(f->sr_cur.p.stride[1]) >> ss_ver),
         f->lf.sr_p[2] + (y * PXSTRIDE(f->sr_cur.p.stride[1]) >> ss_ver)
     };
-    const int has_chroma = f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400;
+    const int has_chroma = f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400 &&
+                           !f->c->luma_only;
     for (int pl = 0; pl < 1 + 2 * has_chroma; pl++) {
         const int ss_ver = pl && f->cur.p.layout == DAV1D_PIXEL_LAYOUT_I420;
         const int h_start = 8 * !!sby >> ss_ver;
@@ -2149,14 +2326,22 @@ void bytefn(dav1d_filter_sbrow_lr)(Dav1dFrameContext *const f, const int sby) {
 }
 
 void bytefn(dav1d_filter_sbrow)(Dav1dFrameContext *const f, const int sby) {
+    Dav1dPerfThread *const perf = f->c->tc->perf.n ? &f->c->tc->perf : NULL;
     bytefn(dav1d_filter_sbrow_deblock_cols)(f, sby);
     bytefn(dav1d_filter_sbrow_deblock_rows)(f, sby);
-    if (f->seq_hdr->cdef)
+    if (perf) dav1d_perf_thread_sample(perf, DAV1D_PERF_TASK_DEBLOCK);
+    if (f->seq_hdr->cdef) {
         bytefn(dav1d_filter_sbrow_cdef)(f->c->tc, sby);
-    if (f->frame_hdr->width[0] != f->frame_hdr->width[1])
+        if (perf) dav1d_perf_thread_sample(perf, DAV1D_PERF_TASK_CDEF);
+    }
+    if (f->frame_hdr->width[0] != f->frame_hdr->width[1]) {
         bytefn(dav1d_filter_sbrow_resize)(f, sby);
-    if (f->lf.restore_planes)
+        if (perf) dav1d_perf_thread_sample(perf, DAV1D_PERF_TASK_SUPER_RESOLUTION);
+    }
+    if (f->lf.restore_planes) {
         bytefn(dav1d_filter_sbrow_lr)(f, sby);
+        if (perf) dav1d_perf_thread_sample(perf, DAV1D_PERF_TASK_LOOP_RESTORATION);
+    }
 }
 
 void bytefn(dav1d_backup_ipred_edge)(Dav1dTaskContext *const t) {
@@ -2172,7 +2357,7 @@ void bytefn(dav1d_backup_ipred_edge)(Dav1dTaskContext *const t) {
     pixel_copy(&f->ipred_edge[0][sby_off + x_off * 4], y,
                4 * (ts->tiling.col_end - x_off));
 
-    if (f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400) {
+    if (f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I400 && !f->c->luma_only) {
         const int ss_ver = f->cur.p.layout == DAV1D_PIXEL_LAYOUT_I420;
         const int ss_hor = f->cur.p.layout != DAV1D_PIXEL_LAYOUT_I444;
 
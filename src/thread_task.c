@@ -31,6 +31,7 @@
 
 #include "src/thread_task.h"
 #include "src/fg_apply.h"
+#include "src/trace.h"
 
 // This function resets the cur pointer to the first frame theoretically
 // executable after a task completed (ie. each time we update some progress or
@@ -255,6 +256,7 @@ static int create_filter_sbrow(Dav1dFrameContext *const f,
     t->recon_progress = 1;
     t->deblock_progress = 0;
     t->type = pass == 1 ? DAV1D_TASK_TYPE_ENTROPY_PROGRESS :
+              f->c->entropy_only ? DAV1D_TASK_TYPE_RECONSTRUCTION_PROGRESS :
               has_deblock ? DAV1D_TASK_TYPE_DEBLOCK_COLS :
               has_cdef || has_lr /* i.e. LR backup */ ? DAV1D_TASK_TYPE_DEBLOCK_ROWS :
               has_resize ? DAV1D_TASK_TYPE_SUPER_RESOLUTION :
@@ -384,19 +386,42 @@ static inline int ensure_progress(struct TaskThreadData *const ttd,
     return 0;
 }
 
+// the deblocking of an sbrow backs up lines for CDEF / LR into its slot of
+// the line buffer ring (see dav1d_decode_frame_init()), which must no longer
+// be in use by the sbrows that previously occupied it: the one stored there,
+// and the next one, which reads its bottom lines
+static inline int check_line_buf(Dav1dFrameContext *const f, const int sby) {
+    const int prev = sby - f->lf.line_buf_sbh;
+    if (prev < 0 || !(f->seq_hdr->cdef || f->lf.restore_planes)) return 1;
+    atomic_uint *const prog = f->frame_thread.frame_progress;
+    for (int n = prev; n <= prev + 1; n++)
+        if (!(atomic_load(&prog[n >> 5]) & (1U << (n & 31))))
+            return 0;
+    return 1;
+}
+
+// returns 0 if the task can run, else 1 and the blocking dependency in *stall
 static inline int check_tile(Dav1dTask *const t, Dav1dFrameContext *const f,
-                             const int frame_mt)
+                             const int frame_mt,
+                             enum Dav1dStallReason *const stall)
 {
     const int tp = t->type == DAV1D_TASK_TYPE_TILE_ENTROPY;
     const int tile_idx = (int)(t - f->task_thread.tile_tasks[tp]);
     Dav1dTileState *const ts = &f->ts[tile_idx];
-    const int p1 = atomic_load(&ts->progress[tp]);
-    if (p1 < t->sby) return 1;
+    const int p1 = atomic_load(&ts->progress[tp].sby);
+    if (p1 < t->sby) {
+        *stall = tp ? DAV1D_STALL_ENTROPY_PROGRESS :
+                      DAV1D_STALL_RECONSTRUCTION_PROGRESS;
+        return 1;
+    }
     int error = p1 == TILE_ERROR;
     error |= atomic_fetch_or(&f->task_thread.error, error);
     if (!error && frame_mt && !tp) {
-        const int p2 = atomic_load(&ts->progress[1]);
-        if (p2 <= t->sby) return 1;
+        const int p2 = atomic_load(&ts->progress[1].sby);
+        if (p2 <= t->sby) {
+            *stall = DAV1D_STALL_ENTROPY_PROGRESS;
+            return 1;
+        }
         error = p2 == TILE_ERROR;
         error |= atomic_fetch_or(&f->task_thread.error, error);
     }
@@ -425,7 +450,10 @@ static inline int check_tile(Dav1dTask *const t, Dav1dFrameContext *const f,
                 lowest = iclip(max, 1, f->refp[n].p.p.h);
             }
             const unsigned p3 = atomic_load(&f->refp[n].progress[!tp]);
-            if (p3 < lowest) return 1;
+            if (p3 < lowest) {
+                *stall = DAV1D_STALL_REFERENCE_PROGRESS;
+                return 1;
+            }
             atomic_fetch_or(&f->task_thread.error, p3 == FRAME_ERROR);
         }
     }
@@ -462,6 +490,12 @@ static inline void abort_frame(Dav1dFrameContext *const f, const int error) {
     pthread_cond_signal(&f->task_thread.cond);
 }
 
+static inline void perf_sample(Dav1dTaskContext *const tc,
+                               const enum Dav1dPerfTaskType type)
+{
+    if (tc->perf.n) dav1d_perf_thread_sample(&tc->perf, type);
+}
+
 static inline void delayed_fg_task(const Dav1dContext *const c,
                                    struct TaskThreadData *const ttd)
 {
@@ -547,21 +581,58 @@ static inline void delayed_fg_task(const Dav1dContext *const c,
     }
 }
 
+// whether the calling worker runs on one of the slower cores of a hybrid CPU
+static inline int on_slow_core(const Dav1dContext *const c) {
+#if defined(HAVE_CPU_TOPOLOGY) && defined(HAVE_SCHED_GETCPU)
+    if (c->n_fast_cpus) {
+        const int cpu = sched_getcpu();
+        return cpu >= 0 && !CPU_ISSET(cpu, &c->fast_cpus);
+    }
+#endif
+    return 0;
+}
+
 void *dav1d_worker_task(void *data) {
     Dav1dTaskContext *const tc = data;
     const Dav1dContext *const c = tc->c;
     struct TaskThreadData *const ttd = tc->task_thread.ttd;
 
     dav1d_set_thread_name("dav1d-worker");
+    if (c->perf_counters) dav1d_perf_thread_open(&tc->perf);
 
     pthread_mutex_lock(&ttd->lock);
+    if (c->track_idle) tc->task_thread.stall.start = dav1d_clock_ns();
     for (;;) {
+        // dependency of the first task found blocked, if any
+        enum Dav1dStallReason stall = DAV1D_STALL_NO_WORK;
+        // first runnable tile task passed over on a slow core, and the
+        // frame to rewind the scan to so other workers still find it
+        Dav1dTask *slow_t = NULL, *slow_prev_t = NULL;
+        Dav1dFrameContext *slow_f = NULL;
+        unsigned slow_cur = 0;
         if (tc->task_thread.die) break;
+        if ((unsigned) (tc - c->tc) >= ttd->n_active) {
+            // parked by energy saving mode until more threads are needed;
+            // pass on the signal which may have woken us up, as the task it
+            // announced is left to the running threads
+            tc->task_thread.flushed = 1;
+            pthread_cond_signal(&tc->task_thread.td.cond);
+            pthread_cond_signal(&ttd->cond);
+            stall = DAV1D_STALL_PARKED;
+            if (c->track_idle) {
+                tc->task_thread.stall.reason = stall;
+                tc->task_thread.stall.wait_start = dav1d_clock_ns();
+            }
+            pthread_cond_wait(&ttd->parked_cond, &ttd->lock);
+            goto unpark;
+        }
         if (atomic_load(c->flush)) goto park;
 
         merge_pending(c);
         if (ttd->delayed_fg.exec) { // run delayed film grain first
+            if (tc->perf.n) dav1d_perf_thread_start(&tc->perf);
             delayed_fg_task(c, ttd);
+            perf_sample(tc, DAV1D_PERF_TASK_FILM_GRAIN);
             continue;
         }
         Dav1dFrameContext *f;
@@ -588,9 +659,15 @@ void *dav1d_worker_task(void *data) {
                         atomic_fetch_or(&f->task_thread.error, p1 == TILE_ERROR);
                         goto found;
                     }
+                    if (stall == DAV1D_STALL_NO_WORK) stall = DAV1D_STALL_CDF;
                 }
             }
         }
+        // Tile decoding is on the critical path, while post-filtering is
+        // throughput work; on the slower cores of a hybrid CPU, prefer the
+        // latter and leave the former to the faster cores, unless there is
+        // nothing else to do.
+        const int slow_core = on_slow_core(c);
         while (ttd->cur < c->n_fc) { // run decoding tasks last
             const unsigned first = atomic_load(&ttd->first);
             f = &c->fc[(first + ttd->cur) % c->n_fc];
@@ -598,30 +675,41 @@ void *dav1d_worker_task(void *data) {
             prev_t = f->task_thread.task_cur_prev;
             t = prev_t ? prev_t->next : f->task_thread.task_head;
             while (t) {
+                enum Dav1dStallReason blocker;
                 if (t->type == DAV1D_TASK_TYPE_INIT_CDF) goto next;
                 else if (t->type == DAV1D_TASK_TYPE_TILE_ENTROPY ||
                          t->type == DAV1D_TASK_TYPE_TILE_RECONSTRUCTION)
                 {
                     // if not bottom sbrow of tile, this task will be re-added
                     // after it's finished
-                    if (!check_tile(t, f, c->n_fc > 1))
-                        goto found;
+                    if (!check_tile(t, f, c->n_fc > 1, &blocker)) {
+                        if (!slow_core) goto found;
+                        if (!slow_t) {
+                            slow_t = t;
+                            slow_prev_t = prev_t;
+                            slow_f = f;
+                            slow_cur = ttd->cur;
+                        }
+                        goto next;
+                    }
                 } else if (t->recon_progress) {
                     const int p = t->type == DAV1D_TASK_TYPE_ENTROPY_PROGRESS;
                     int error = atomic_load(&f->task_thread.error);
                     assert(!atomic_load(&f->task_thread.done[p]) || error);
                     const int tile_row_base = f->frame_hdr->tiling.cols *
                                               f->frame_thread.next_tile_row[p];
+                    blocker = p ? DAV1D_STALL_ENTROPY_PROGRESS :
+                                  DAV1D_STALL_RECONSTRUCTION_PROGRESS;
                     if (p) {
                         atomic_int *const prog = &f->frame_thread.entropy_progress;
                         const int p1 = atomic_load(prog);
-                        if (p1 < t->sby) goto next;
+                        if (p1 < t->sby) goto blocked;
                         atomic_fetch_or(&f->task_thread.error, p1 == TILE_ERROR);
                     }
                     for (int tc = 0; tc < f->frame_hdr->tiling.cols; tc++) {
                         Dav1dTileState *const ts = &f->ts[tile_row_base + tc];
-                        const int p2 = atomic_load(&ts->progress[p]);
-                        if (p2 < t->recon_progress) goto next;
+                        const int p2 = atomic_load(&ts->progress[p].sby);
+                        if (p2 < t->recon_progress) goto blocked;
                         atomic_fetch_or(&f->task_thread.error, p2 == TILE_ERROR);
                     }
                     if (t->sby + 1 < f->sbh) {
@@ -642,6 +730,13 @@ void *dav1d_worker_task(void *data) {
                     const int p1 = atomic_load(&prog[(t->sby - 1) >> 5]);
                     if (p1 & (1U << ((t->sby - 1) & 31)))
                         goto found;
+                    blocker = DAV1D_STALL_DEBLOCK_PROGRESS;
+                } else if (t->type == DAV1D_TASK_TYPE_DEBLOCK_ROWS &&
+                           !t->deblock_progress)
+                {
+                    if (check_line_buf(f, t->sby))
+                        goto found;
+                    blocker = DAV1D_STALL_LINE_BUFFER;
                 } else {
                     assert(t->deblock_progress);
                     const int p1 = atomic_load(&f->frame_thread.deblock_progress);
@@ -649,14 +744,25 @@ void *dav1d_worker_task(void *data) {
                         atomic_fetch_or(&f->task_thread.error, p1 == TILE_ERROR);
                         goto found;
                     }
+                    blocker = DAV1D_STALL_DEBLOCK_PROGRESS;
                 }
+            blocked:
+                if (stall == DAV1D_STALL_NO_WORK) stall = blocker;
             next:
                 prev_t = t;
                 t = t->next;
-                f->task_thread.task_cur_prev = prev_t;
+                // past a tile task passed over on a slow core, keep the
+                // scan position so that other workers still find it
+                if (!slow_t) f->task_thread.task_cur_prev = prev_t;
             }
             ttd->cur++;
         }
+        if (slow_t) {
+            f = slow_f;
+            t = slow_t;
+            prev_t = slow_prev_t;
+            goto found;
+        }
         if (reset_task_cur(c, ttd, UINT_MAX)) continue;
         if (merge_pending(c)) continue;
     park:
@@ -664,7 +770,18 @@ void *dav1d_worker_task(void *data) {
         pthread_cond_signal(&tc->task_thread.td.cond);
         // we want to be woken up next time progress is signaled
         atomic_store(&ttd->cond_signaled, 0);
+        if (c->track_idle) {
+            tc->task_thread.stall.reason = stall;
+            tc->task_thread.stall.wait_start = dav1d_clock_ns();
+        }
         pthread_cond_wait(&ttd->cond, &ttd->lock);
+    unpark:
+        if (c->track_idle) {
+            tc->task_thread.stall.time[stall] +=
+                dav1d_clock_ns() - tc->task_thread.stall.wait_start;
+            tc->task_thread.stall.count[stall]++;
+            tc->task_thread.stall.wait_start = 0;
+        }
         tc->task_thread.flushed = 0;
         reset_task_cur(c, ttd, UINT_MAX);
         continue;
@@ -676,6 +793,11 @@ void *dav1d_worker_task(void *data) {
         if (!t->next) f->task_thread.task_tail = prev_t;
         if (t->type > DAV1D_TASK_TYPE_INIT_CDF && !f->task_thread.task_head)
             ttd->cur++;
+        if (slow_t) {
+            // rewind to the frame of the tile task passed over; the task
+            // cursors were not advanced past it
+            ttd->cur = umin(ttd->cur, slow_cur);
+        }
         t->next = NULL;
         // we don't need to check cond_signaled here, since we found a task
         // after the last signal so we want to re-signal the next waiting thread
@@ -688,12 +810,21 @@ void *dav1d_worker_task(void *data) {
         int error = atomic_fetch_or(&f->task_thread.error, flush) | flush;
 
         // run it
+        if (c->work_stats)
+            atomic_fetch_add_explicit(&f->n_tasks, 1, memory_order_relaxed);
         tc->f = f;
         int sby = t->sby;
+        const int row = (int) (tc - c->tc);
+        uint64_t start = f->stats.data ? dav1d_clock_ns() : 0;
+        dav1d_trace5(task_begin, c, row, t->frame_idx, t->type, sby);
+        if (tc->perf.n) dav1d_perf_thread_start(&tc->perf);
         switch (t->type) {
         case DAV1D_TASK_TYPE_INIT: {
             assert(c->n_fc > 1);
             int res = dav1d_decode_frame_init(f);
+            dav1d_decode_stats_add(f, row, DAV1D_DECODE_STAGE_INIT, &start);
+            perf_sample(tc, DAV1D_PERF_TASK_INIT);
+            dav1d_trace2(task_end, c, row);
             int p1 = f->in_cdf.progress ? atomic_load(f->in_cdf.progress) : 1;
             if (res || p1 == TILE_ERROR) {
                 pthread_mutex_lock(&ttd->lock);
@@ -712,12 +843,19 @@ void *dav1d_worker_task(void *data) {
             int res = DAV1D_ERR(EINVAL);
             if (!atomic_load(&f->task_thread.error))
                 res = dav1d_decode_frame_init_cdf(f);
+            dav1d_decode_stats_add(f, row, DAV1D_DECODE_STAGE_INIT, &start);
+            perf_sample(tc, DAV1D_PERF_TASK_INIT);
+            dav1d_trace2(task_end, c, row);
             if (f->frame_hdr->refresh_context && !f->task_thread.update_set) {
                 atomic_store(f->out_cdf.progress, res < 0 ? TILE_ERROR : 1);
             }
             if (!res) {
                 assert(c->n_fc > 1);
-                for (int p = 1; p <= 2; p++) {
+                // with entropy_only, there is no reconstruction pass
+                const int last_pass = c->entropy_only ? 1 : 2;
+                if (c->entropy_only)
+                    atomic_store(&f->task_thread.done[0], 1);
+                for (int p = 1; p <= last_pass; p++) {
                     const int res = dav1d_task_create_tile_sbrow(f, p, 0);
                     if (res) {
                         pthread_mutex_lock(&ttd->lock);
@@ -728,7 +866,7 @@ void *dav1d_worker_task(void *data) {
                                          f->frame_hdr->tiling.cols *
                                          f->frame_hdr->tiling.rows + f->sbh);
                         atomic_store(&f->sr_cur.progress[p - 1], FRAME_ERROR);
-                        if (p == 2 && atomic_load(&f->task_thread.done[1])) {
+                        if (p == last_pass && atomic_load(&f->task_thread.done[1])) {
                             assert(!atomic_load(&f->task_thread.task_counter));
                             dav1d_decode_frame_exit(f, DAV1D_ERR(ENOMEM));
                             f->n_tile_data = 0;
@@ -759,6 +897,11 @@ void *dav1d_worker_task(void *data) {
             tc->frame_thread.pass = !uses_2pass ? 0 :
                 1 + (t->type == DAV1D_TASK_TYPE_TILE_RECONSTRUCTION);
             if (!error) error = dav1d_decode_tile_sbrow(tc);
+            dav1d_decode_stats_add(f, row, p ? DAV1D_DECODE_STAGE_ENTROPY :
+                                   DAV1D_DECODE_STAGE_RECONSTRUCTION, &start);
+            perf_sample(tc, p ? DAV1D_PERF_TASK_ENTROPY :
+                        DAV1D_PERF_TASK_RECONSTRUCTION);
+            dav1d_trace2(task_end, c, row);
             const int progress = error ? TILE_ERROR : 1 + sby;
 
             // signal progress
@@ -766,19 +909,20 @@ void *dav1d_worker_task(void *data) {
             if (((sby + 1) << f->sb_shift) < ts->tiling.row_end) {
                 t->sby++;
                 t->deps_skip = 0;
-                if (!check_tile(t, f, uses_2pass)) {
-                    atomic_store(&ts->progress[p], progress);
+                enum Dav1dStallReason blocker;
+                if (!check_tile(t, f, uses_2pass, &blocker)) {
+                    atomic_store(&ts->progress[p].sby, progress);
                     reset_task_cur_async(ttd, t->frame_idx, c->n_fc);
                     if (!atomic_fetch_or(&ttd->cond_signaled, 1))
                         pthread_cond_signal(&ttd->cond);
                     goto found_unlocked;
                 }
-                atomic_store(&ts->progress[p], progress);
+                atomic_store(&ts->progress[p].sby, progress);
                 add_pending(f, t);
                 pthread_mutex_lock(&ttd->lock);
             } else {
                 pthread_mutex_lock(&ttd->lock);
-                atomic_store(&ts->progress[p], progress);
+                atomic_store(&ts->progress[p].sby, progress);
                 reset_task_cur(c, ttd, t->frame_idx);
                 error = atomic_load(&f->task_thread.error);
                 if (f->frame_hdr->refresh_context &&
@@ -810,13 +954,32 @@ void *dav1d_worker_task(void *data) {
         case DAV1D_TASK_TYPE_DEBLOCK_COLS:
             if (!atomic_load(&f->task_thread.error))
                 f->bd_fn.filter_sbrow_deblock_cols(f, sby);
+            dav1d_decode_stats_add(f, row, DAV1D_DECODE_STAGE_FILTER, &start);
             if (ensure_progress(ttd, f, t, DAV1D_TASK_TYPE_DEBLOCK_ROWS,
                                 &f->frame_thread.deblock_progress,
-                                &t->deblock_progress)) continue;
+                                &t->deblock_progress))
+            {
+                perf_sample(tc, DAV1D_PERF_TASK_DEBLOCK);
+                dav1d_trace2(task_end, c, row);
+                continue;
+            }
             // fall-through
         case DAV1D_TASK_TYPE_DEBLOCK_ROWS:
+            if (!check_line_buf(f, sby)) {
+                // the columns, if run above, are sampled as their own task
+                if (t->type == DAV1D_TASK_TYPE_DEBLOCK_COLS)
+                    perf_sample(tc, DAV1D_PERF_TASK_DEBLOCK);
+                dav1d_decode_stats_add(f, row, DAV1D_DECODE_STAGE_FILTER, &start);
+                dav1d_trace2(task_end, c, row);
+                t->type = DAV1D_TASK_TYPE_DEBLOCK_ROWS;
+                t->recon_progress = t->deblock_progress = 0;
+                add_pending(f, t);
+                pthread_mutex_lock(&ttd->lock);
+                continue;
+            }
             if (!atomic_load(&f->task_thread.error))
                 f->bd_fn.filter_sbrow_deblock_rows(f, sby);
+            perf_sample(tc, DAV1D_PERF_TASK_DEBLOCK);
             // signal deblock progress
             if (f->frame_hdr->loopfilter.level_y[0] ||
                 f->frame_hdr->loopfilter.level_y[1])
@@ -835,6 +998,8 @@ void *dav1d_worker_task(void *data) {
                 if (sby) {
                     int prog = atomic_load(&f->frame_thread.copy_lpf_progress[(sby - 1) >> 5]);
                     if (~prog & (1U << ((sby - 1) & 31))) {
+                        dav1d_decode_stats_add(f, row, DAV1D_DECODE_STAGE_FILTER, &start);
+                        dav1d_trace2(task_end, c, row);
                         t->type = DAV1D_TASK_TYPE_CDEF;
                         t->recon_progress = t->deblock_progress = 0;
                         add_pending(f, t);
@@ -848,19 +1013,24 @@ void *dav1d_worker_task(void *data) {
             if (f->seq_hdr->cdef) {
                 if (!atomic_load(&f->task_thread.error))
                     f->bd_fn.filter_sbrow_cdef(tc, sby);
+                perf_sample(tc, DAV1D_PERF_TASK_CDEF);
                 reset_task_cur_async(ttd, t->frame_idx, c->n_fc);
                 if (!atomic_fetch_or(&ttd->cond_signaled, 1))
                     pthread_cond_signal(&ttd->cond);
             }
             // fall-through
         case DAV1D_TASK_TYPE_SUPER_RESOLUTION:
-            if (f->frame_hdr->width[0] != f->frame_hdr->width[1])
+            if (f->frame_hdr->width[0] != f->frame_hdr->width[1]) {
                 if (!atomic_load(&f->task_thread.error))
                     f->bd_fn.filter_sbrow_resize(f, sby);
+                perf_sample(tc, DAV1D_PERF_TASK_SUPER_RESOLUTION);
+            }
             // fall-through
         case DAV1D_TASK_TYPE_LOOP_RESTORATION:
-            if (!atomic_load(&f->task_thread.error) && f->lf.restore_planes)
+            if (!atomic_load(&f->task_thread.error) && f->lf.restore_planes) {
                 f->bd_fn.filter_sbrow_lr(f, sby);
+                perf_sample(tc, DAV1D_PERF_TASK_LOOP_RESTORATION);
+            }
             // fall-through
         case DAV1D_TASK_TYPE_RECONSTRUCTION_PROGRESS:
             // dummy to cover for no post-filters
@@ -869,6 +1039,8 @@ void *dav1d_worker_task(void *data) {
             break;
         default: abort();
         }
+        dav1d_decode_stats_add(f, row, DAV1D_DECODE_STAGE_FILTER, &start);
+        dav1d_trace2(task_end, c, row);
         // if task completed [typically LR], signal picture progress as per below
         const int uses_2pass = c->n_fc > 1;
         const int sbh = f->sbh;
@@ -877,8 +1049,12 @@ void *dav1d_worker_task(void *data) {
             error = atomic_load(&f->task_thread.error);
             const unsigned y = sby + 1 == sbh ? UINT_MAX : (unsigned)(sby + 1) * sbsz;
             assert(c->n_fc > 1);
-            if (f->sr_cur.p.data[0] /* upon flush, this can be free'ed already */)
+            if (f->sr_cur.p.data[0] /* upon flush, this can be free'ed already */) {
                 atomic_store(&f->sr_cur.progress[0], error ? FRAME_ERROR : y);
+                // nothing else signals reconstruction progress
+                if (c->entropy_only)
+                    atomic_store(&f->sr_cur.progress[1], error ? FRAME_ERROR : y);
+            }
             atomic_store(&f->frame_thread.entropy_progress,
                          error ? TILE_ERROR : sby + 1);
             if (sby + 1 == sbh)
@@ -931,6 +1107,7 @@ void *dav1d_worker_task(void *data) {
         reset_task_cur(c, ttd, t->frame_idx);
     }
     pthread_mutex_unlock(&ttd->lock);
+    dav1d_perf_thread_close(&tc->perf);
 
     return NULL;
 }
@@ -30,6 +30,7 @@
 
 #include <limits.h>
 
+#include "src/clock.h"
 #include "src/internal.h"
 
 #define FRAME_ERROR (UINT_MAX - 1)
@@ -50,4 +51,16 @@ void dav1d_decode_frame_exit(Dav1dFrameContext *f, int retval);
 int dav1d_decode_frame(Dav1dFrameContext *f);
 int dav1d_decode_tile_sbrow(Dav1dTaskContext *t);
 
+// Charge the time elapsed since *start to the given stage of the frame's
+// decoding cost, in the row of the calling thread, and restart the clock.
+static inline void dav1d_decode_stats_add(Dav1dFrameContext *const f, const int row,
+                                          const enum Dav1dDecodeStage stage,
+                                          uint64_t *const start)
+{
+    if (!f->stats.data) return;
+    const uint64_t now = dav1d_clock_ns();
+    f->stats.time[row].ns[stage] += now - *start;
+    *start = now;
+}
+
 #endif /* DAV1D_SRC_THREAD_TASK_H */
@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2024, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DAV1D_SRC_TRACE_H
+#define DAV1D_SRC_TRACE_H
+
+#include "config.h"
+
+/*
+ * Static (USDT/SDT) tracepoints, all in the "dav1d" provider. Each probe
+ * compiles to a single nop plus an ELF note, so they cost nothing unless a
+ * tracer such as bpftrace or perf attaches to them. See
+ * tools/dav1d_latency.bt for an example consumer.
+ */
+#if CONFIG_USDT_PROBES
+#include <sys/sdt.h>
+
+#define dav1d_trace1(name, a) \
+    DTRACE_PROBE1(dav1d, name, a)
+#define dav1d_trace2(name, a, b) \
+    DTRACE_PROBE2(dav1d, name, a, b)
+#define dav1d_trace3(name, a, b, c) \
+    DTRACE_PROBE3(dav1d, name, a, b, c)
+#define dav1d_trace4(name, a, b, c, d) \
+    DTRACE_PROBE4(dav1d, name, a, b, c, d)
+#define dav1d_trace5(name, a, b, c, d, e) \
+    DTRACE_PROBE5(dav1d, name, a, b, c, d, e)
+#else
+#define dav1d_trace1(name, a) do { } while (0)
+#define dav1d_trace2(name, a, b) do { } while (0)
+#define dav1d_trace3(name, a, b, c) do { } while (0)
+#define dav1d_trace4(name, a, b, c, d) do { } while (0)
+#define dav1d_trace5(name, a, b, c, d, e) do { } while (0)
+#endif
+
+#endif /* DAV1D_SRC_TRACE_H */
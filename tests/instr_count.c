@@ -0,0 +1,312 @@
+/*
+ * Copyright © 2024, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Instruction count regression check. Decodes streams single-threaded with
+ * hardware counters enabled and compares the retired instructions of every
+ * task type against the baseline file. Unlike wall-clock timings, these
+ * counts are stable enough across runs to catch small regressions on shared
+ * machines.
+ *
+ * Baseline lines have the form "<stream> <task> <instructions>", with stream
+ * paths relative to --dir. Lines starting with '#' are ignored.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dav1d/dav1d.h"
+#include "input/input.h"
+
+// meson test treats this exit code as a skipped test
+#define EXIT_SKIP 77
+
+static const char *const task_names[DAV1D_N_PERF_TASK_TYPES] = {
+    [DAV1D_PERF_TASK_INIT]             = "init",
+    [DAV1D_PERF_TASK_ENTROPY]          = "entropy",
+    [DAV1D_PERF_TASK_RECONSTRUCTION]   = "reconstruction",
+    [DAV1D_PERF_TASK_DEBLOCK]          = "deblock",
+    [DAV1D_PERF_TASK_CDEF]             = "cdef",
+    [DAV1D_PERF_TASK_SUPER_RESOLUTION] = "superres",
+    [DAV1D_PERF_TASK_LOOP_RESTORATION] = "looprestoration",
+    [DAV1D_PERF_TASK_FILM_GRAIN]       = "filmgrain",
+};
+
+typedef struct {
+    char *stream;
+    uint64_t instructions[DAV1D_N_PERF_TASK_TYPES];
+} Baseline;
+
+typedef struct {
+    Baseline *entries;
+    int n;
+} BaselineList;
+
+static Baseline *find_entry(BaselineList *const list, const char *const stream,
+                            const int create)
+{
+    for (int i = 0; i < list->n; i++)
+        if (!strcmp(list->entries[i].stream, stream))
+            return &list->entries[i];
+    if (!create) return NULL;
+
+    Baseline *const entries =
+        realloc(list->entries, (list->n + 1) * sizeof(*entries));
+    if (!entries) return NULL;
+    list->entries = entries;
+    Baseline *const b = &entries[list->n];
+    memset(b, 0, sizeof(*b));
+    if (!(b->stream = strdup(stream))) return NULL;
+    list->n++;
+    return b;
+}
+
+static int read_baseline(BaselineList *const list, const char *const filename) {
+    FILE *const f = fopen(filename, "r");
+    if (!f) return errno == ENOENT ? 0 : -1;
+
+    char line[1024], stream[1024], task[64];
+    uint64_t instructions;
+    int lineno = 0, res = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+        if (sscanf(line, "%1023s %63s %" SCNu64, stream, task, &instructions) != 3) {
+            fprintf(stderr, "%s:%d: malformed line\n", filename, lineno);
+            res = -1;
+            break;
+        }
+        int t;
+        for (t = 0; t < DAV1D_N_PERF_TASK_TYPES; t++)
+            if (!strcmp(task, task_names[t])) break;
+        if (t == DAV1D_N_PERF_TASK_TYPES) {
+            fprintf(stderr, "%s:%d: unknown task type '%s'\n", filename, lineno, task);
+            res = -1;
+            break;
+        }
+        Baseline *const b = find_entry(list, stream, 1);
+        if (!b) {
+            res = -1;
+            break;
+        }
+        b->instructions[t] = instructions;
+    }
+    fclose(f);
+    return res;
+}
+
+static int write_baseline(const BaselineList *const list, const char *const filename) {
+    FILE *const f = fopen(filename, "w");
+    if (!f) return -1;
+
+    fprintf(f, "# Retired user-space instructions per stream and task type, as\n"
+               "# measured by instr_count with a single decoding thread.\n"
+               "# Regenerate with: instr_count --update --baseline <this file> <stream>...\n");
+    for (int i = 0; i < list->n; i++) {
+        const Baseline *const b = &list->entries[i];
+        for (int t = 0; t < DAV1D_N_PERF_TASK_TYPES; t++)
+            if (b->instructions[t])
+                fprintf(f, "%s %s %" PRIu64 "\n", b->stream, task_names[t],
+                        b->instructions[t]);
+    }
+    return fclose(f) ? -1 : 0;
+}
+
+static int decode_stream(const char *const filename, Dav1dPerfCounters *const pc) {
+    Dav1dSettings s;
+    dav1d_default_settings(&s);
+    s.n_threads = 1;
+    s.max_frame_delay = 1;
+    s.perf_counters = 1;
+
+    DemuxerContext *in;
+    unsigned fps[2], total, timebase[2];
+    int res = input_open(&in, NULL, filename, fps, &total, timebase);
+    if (res < 0) return res;
+
+    Dav1dContext *c;
+    if ((res = dav1d_open(&c, &s)) < 0) {
+        input_close(in);
+        return res;
+    }
+
+    Dav1dData data;
+    Dav1dPicture p;
+    if (!input_read(in, &data)) {
+        do {
+            res = dav1d_send_data(c, &data);
+            if (res < 0 && res != DAV1D_ERR(EAGAIN)) break;
+            do {
+                memset(&p, 0, sizeof(p));
+                if (!(res = dav1d_get_picture(c, &p)))
+                    dav1d_picture_unref(&p);
+            } while (!res);
+            if (res != DAV1D_ERR(EAGAIN)) break;
+            res = 0;
+        } while (data.sz || (!input_read(in, &data) && data.sz));
+        if (data.sz) dav1d_data_unref(&data);
+    }
+    // drain
+    while (!res) {
+        memset(&p, 0, sizeof(p));
+        if (!(res = dav1d_get_picture(c, &p)))
+            dav1d_picture_unref(&p);
+    }
+    if (res == DAV1D_ERR(EAGAIN))
+        res = dav1d_get_perf_counters(c, pc);
+    else
+        fprintf(stderr, "%s: decoding error: %s\n", filename, strerror(DAV1D_ERR(res)));
+
+    dav1d_close(&c);
+    input_close(in);
+    return res;
+}
+
+static void usage(const char *const app, const char *const reason) {
+    if (reason) fprintf(stderr, "%s\n\n", reason);
+    fprintf(stderr, "Usage: %s [options] [stream...]\n\n", app);
+    fprintf(stderr, "Streams default to all streams of the baseline file.\n"
+            "Supported options:\n"
+            " --baseline $file:    baseline file (required)\n"
+            " --dir $dir:          directory that stream paths are relative to (default: .)\n"
+            " --tolerance $pct:    allowed deviation from the baseline in percent (default: 1.0)\n"
+            " --update:            write the measured counts to the baseline file\n");
+    exit(1);
+}
+
+int main(const int argc, char *const *const argv) {
+    static const struct option long_opts[] = {
+        { "baseline",  1, NULL, 'b' },
+        { "dir",       1, NULL, 'd' },
+        { "tolerance", 1, NULL, 't' },
+        { "update",    0, NULL, 'u' },
+        { NULL,        0, NULL, 0 },
+    };
+    const char *baseline = NULL, *dir = ".";
+    double tolerance = 1.0;
+    int update = 0, o;
+
+    while ((o = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+        switch (o) {
+        case 'b': baseline = optarg; break;
+        case 'd': dir = optarg; break;
+        case 't': {
+            char *end;
+            tolerance = strtod(optarg, &end);
+            if (*end || end == optarg || tolerance < 0)
+                usage(argv[0], "Invalid tolerance");
+            break;
+        }
+        case 'u': update = 1; break;
+        default: usage(argv[0], NULL);
+        }
+    }
+    if (!baseline) usage(argv[0], "Missing baseline file");
+
+    BaselineList list = { 0 };
+    if (read_baseline(&list, baseline)) {
+        fprintf(stderr, "Failed to read baseline file %s\n", baseline);
+        return EXIT_FAILURE;
+    }
+
+    const int n_streams = optind < argc ? argc - optind : list.n;
+    if (!n_streams) {
+        fprintf(stderr, "No streams to measure\n");
+        return EXIT_SKIP;
+    }
+
+    int regressions = 0, improvements = 0;
+    for (int i = 0; i < n_streams; i++) {
+        const char *const stream =
+            optind < argc ? argv[optind + i] : list.entries[i].stream;
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, stream);
+
+        Dav1dPerfCounters pc;
+        const int res = decode_stream(path, &pc);
+        if (res == DAV1D_ERR(ENOSYS) ||
+            (!res && !(pc.available & DAV1D_PERF_COUNTER_INSTRUCTIONS)))
+        {
+            fprintf(stderr, "Instruction counters are not available, skipping\n");
+            return EXIT_SKIP;
+        }
+        if (res < 0) return EXIT_FAILURE;
+
+        Baseline *const b = find_entry(&list, stream, update);
+        if (update) {
+            if (!b) return EXIT_FAILURE;
+            for (int t = 0; t < DAV1D_N_PERF_TASK_TYPES; t++)
+                b->instructions[t] = pc.task[t].instructions;
+            printf("%s: updated\n", stream);
+            continue;
+        }
+        if (!b) {
+            fprintf(stderr, "%s: no baseline\n", stream);
+            regressions++;
+            continue;
+        }
+
+        // the last row compares the totals of all task types
+        uint64_t ref_total = 0, cur_total = 0;
+        for (int t = 0; t <= DAV1D_N_PERF_TASK_TYPES; t++) {
+            const int is_total = t == DAV1D_N_PERF_TASK_TYPES;
+            const uint64_t ref = is_total ? ref_total : b->instructions[t];
+            const uint64_t cur = is_total ? cur_total : pc.task[t].instructions;
+            if (!ref && !cur) continue;
+            ref_total += ref;
+            cur_total += cur;
+            const double diff = ref ? 100.0 * ((double) cur - ref) / ref : 100.0;
+            const char *verdict = "";
+            if (diff > tolerance) {
+                verdict = " REGRESSION";
+                regressions++;
+            } else if (diff < -tolerance) {
+                verdict = " (improved, update the baseline)";
+                improvements++;
+            }
+            printf("%s %-16s %15" PRIu64 " %15" PRIu64 " %+7.2f%%%s\n", stream,
+                   is_total ? "total" : task_names[t], ref, cur, diff, verdict);
+        }
+    }
+
+    if (update && write_baseline(&list, baseline)) {
+        fprintf(stderr, "Failed to write baseline file %s\n", baseline);
+        return EXIT_FAILURE;
+    }
+    if (improvements)
+        printf("%d task type(s) improved beyond the tolerance\n", improvements);
+    if (regressions)
+        printf("%d task type(s) regressed beyond the tolerance\n", regressions);
+
+    return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
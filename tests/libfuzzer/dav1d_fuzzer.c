@@ -28,8 +28,10 @@
 #include "config.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -55,6 +57,35 @@ static unsigned r32le(const uint8_t *const p) {
 
 #define DAV1D_FUZZ_MAX_SIZE 4096 * 4096
 
+#ifdef DAV1D_PERF_FUZZING
+// decoding work (blocks + coefficient tokens + tasks) allowed per input byte,
+// on top of a fixed allowance
+#ifndef DAV1D_FUZZ_MAX_WORK_PER_BYTE
+#define DAV1D_FUZZ_MAX_WORK_PER_BYTE 4096
+#endif
+#ifndef DAV1D_FUZZ_MAX_WORK_BASE
+#define DAV1D_FUZZ_MAX_WORK_BASE (1 << 20)
+#endif
+
+// abort on inputs that are disproportionately expensive to decode for the
+// number of bytes fed so far, so that the fuzzer reports algorithmic worst
+// cases instead of crashes
+static void check_work(Dav1dContext *const ctx, const size_t size) {
+    Dav1dWorkStats stats;
+    if (dav1d_get_work_stats(ctx, &stats)) return;
+
+    const uint64_t work = stats.blocks + stats.coefs + stats.tasks;
+    const uint64_t max_work = DAV1D_FUZZ_MAX_WORK_BASE +
+                              (uint64_t) size * DAV1D_FUZZ_MAX_WORK_PER_BYTE;
+    if (work > max_work) {
+        fprintf(stderr, "Decoding work %" PRIu64 " exceeds %" PRIu64 " for %zu bytes "
+                "(%" PRIu64 " frames, %" PRIu64 " blocks, %" PRIu64 " coefs, %" PRIu64 " tasks)\n",
+                work, max_work, size, stats.frames, stats.blocks, stats.coefs, stats.tasks);
+        abort();
+    }
+}
+#endif
+
 // search for "--cpumask xxx" in argv and remove both parameters
 int LLVMFuzzerInitialize(int *argc, char ***argv) {
     int i = 1;
@@ -117,6 +148,10 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
 
 #ifdef DAV1D_MT_FUZZING
     settings.max_frame_delay = settings.n_threads = 4;
+#elif defined(DAV1D_PERF_FUZZING)
+    // worker threads, so that the scheduler's tasks are counted as well
+    settings.max_frame_delay = settings.n_threads = 2;
+    settings.work_stats = 1;
 #elif defined(DAV1D_ALLOC_FAIL)
     settings.max_frame_delay = max_frame_delay;
     settings.n_threads = n_threads;
@@ -176,6 +211,11 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
 
         if (buf.sz > 0)
             dav1d_data_unref(&buf);
+#ifdef DAV1D_PERF_FUZZING
+        // check after every packet, relative to the input consumed so far,
+        // so that an expensive input aborts before it is fully decoded
+        check_work(ctx, ptr - data);
+#endif
     }
 
     memset(&pic, 0, sizeof(pic));
@@ -187,12 +227,18 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
                 dav1d_picture_unref(&pic2);
         } while (err != DAV1D_ERR(EAGAIN));
 
+#ifdef DAV1D_PERF_FUZZING
+        check_work(ctx, size);
+#endif
         dav1d_close(&ctx);
         dav1d_picture_unref(&pic);
         return 0;
     }
 
 cleanup:
+#ifdef DAV1D_PERF_FUZZING
+    check_work(ctx, size);
+#endif
     dav1d_close(&ctx);
 end:
     return 0;
@@ -47,37 +47,17 @@
 #ifdef _WIN32
 # include <windows.h>
 #endif
-#ifdef __APPLE__
-#include <mach/mach_time.h>
-#endif
 
 #include "dav1d/dav1d.h"
 
+#include "src/thread.h"
+
 #include "input/input.h"
 
 #include "output/output.h"
 
 #include "dav1d_cli_parse.h"
-
-static uint64_t get_time_nanos(void) {
-#ifdef _WIN32
-    LARGE_INTEGER frequency;
-    QueryPerformanceFrequency(&frequency);
-    LARGE_INTEGER t;
-    QueryPerformanceCounter(&t);
-    uint64_t seconds = t.QuadPart / frequency.QuadPart;
-    uint64_t fractions = t.QuadPart % frequency.QuadPart;
-    return 1000000000 * seconds + 1000000000 * fractions / frequency.QuadPart;
-#elif defined(HAVE_CLOCK_GETTIME)
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return 1000000000ULL * ts.tv_sec + ts.tv_nsec;
-#elif defined(__APPLE__)
-    mach_timebase_info_data_t info;
-    mach_timebase_info(&info);
-    return mach_absolute_time() * info.numer / info.denom;
-#endif
-}
+#include "dav1d_time.h"
 
 static void sleep_nanos(uint64_t d) {
 #ifdef _WIN32
@@ -182,25 +162,526 @@ static void picture_release(Dav1dPicture *const p, void *const _) {
     free(p->allocator_data);
 }
 
+static void print_perf_counters(Dav1dContext *const c) {
+    static const char *const names[DAV1D_N_PERF_TASK_TYPES] = {
+        [DAV1D_PERF_TASK_INIT]             = "init",
+        [DAV1D_PERF_TASK_ENTROPY]          = "entropy",
+        [DAV1D_PERF_TASK_RECONSTRUCTION]   = "reconstruction",
+        [DAV1D_PERF_TASK_DEBLOCK]          = "deblock",
+        [DAV1D_PERF_TASK_CDEF]             = "cdef",
+        [DAV1D_PERF_TASK_SUPER_RESOLUTION] = "superres",
+        [DAV1D_PERF_TASK_LOOP_RESTORATION] = "looprestoration",
+        [DAV1D_PERF_TASK_FILM_GRAIN]       = "filmgrain",
+    };
+    Dav1dPerfCounters pc;
+
+    if (dav1d_get_perf_counters(c, &pc) < 0) {
+        fprintf(stderr, "Hardware performance counters are not available\n");
+        return;
+    }
+    fprintf(stderr, "%-16s %10s %15s %15s %6s %12s %15s\n", "task", "runs",
+            "cycles", "instructions", "ipc", "llc misses", "stalled cycles");
+    for (int i = 0; i < DAV1D_N_PERF_TASK_TYPES; i++) {
+        const Dav1dTaskPerfCounters *const t = &pc.task[i];
+        if (!t->runs) continue;
+        fprintf(stderr, "%-16s %10" PRIu64 " %15" PRIu64 " %15" PRIu64 " %6.2f %12" PRIu64
+                " %15" PRIu64 "\n", names[i], t->runs, t->cycles, t->instructions,
+                t->cycles ? (double) t->instructions / t->cycles : 0.0,
+                t->llc_misses, t->stalled_cycles);
+    }
+}
+
+static void print_stall_stats(Dav1dContext *const c) {
+    static const struct {
+        const char *name, *hint;
+    } reasons[DAV1D_N_STALL_REASONS] = {
+        [DAV1D_STALL_NO_WORK] =
+            { "no work", "input is not fed, or output is not consumed, fast enough" },
+        [DAV1D_STALL_ENTROPY_PROGRESS] =
+            { "entropy", "symbol decoding of tiles; more tile columns would help" },
+        [DAV1D_STALL_RECONSTRUCTION_PROGRESS] =
+            { "reconstruction", "reconstruction of tiles; more tile columns would help" },
+        [DAV1D_STALL_REFERENCE_PROGRESS] =
+            { "reference", "inter-frame dependencies; long motion vectors or a deep "
+                           "reference chain" },
+        [DAV1D_STALL_DEBLOCK_PROGRESS] =
+            { "deblock", "superblock row post-filtering" },
+        [DAV1D_STALL_CDF] =
+            { "cdf", "entropy context propagation between frames; disable_cdf_update "
+                     "or an early context_update_tile_id would help" },
+        [DAV1D_STALL_LINE_BUFFER] =
+            { "line buffer", "post-filter line buffers shared between superblock rows" },
+        [DAV1D_STALL_PARKED] =
+            { "parked", "fewer threads sufficed for the target framerate (--energysaving)" },
+    };
+    Dav1dStallStats st;
+
+    if (dav1d_get_stall_stats(c, &st) < 0) {
+        fprintf(stderr, "Stall statistics are not available (requires --threads > 1)\n");
+        return;
+    }
+    uint64_t idle = 0;
+    int critical = DAV1D_STALL_NO_WORK;
+    for (int i = 0; i < DAV1D_N_STALL_REASONS; i++) {
+        idle += st.stall_time[i];
+        if (st.stall_time[i] > st.stall_time[critical])
+            critical = i;
+    }
+    const double total = (double) (st.busy_time + idle);
+    fprintf(stderr, "%d worker threads, %.1f%% utilization\n", st.n_threads,
+            total ? 100.0 * st.busy_time / total : 0.0);
+    fprintf(stderr, "%-16s %10s %12s %8s\n", "blocked on", "stalls", "idle (ms)", "share");
+    for (int i = 0; i < DAV1D_N_STALL_REASONS; i++)
+        fprintf(stderr, "%-16s %10" PRIu64 " %12.1f %7.1f%%\n", reasons[i].name,
+                st.stalls[i], st.stall_time[i] / 1e6,
+                idle ? 100.0 * st.stall_time[i] / idle : 0.0);
+    if (idle)
+        fprintf(stderr, "critical path: %s (%s)\n", reasons[critical].name,
+                reasons[critical].hint);
+}
+
+static void print_energy_stats(Dav1dContext *const c) {
+    Dav1dEnergyStats st;
+
+    if (dav1d_get_energy_stats(c, &st) < 0) {
+        fprintf(stderr, "Energy statistics are not available (requires --threads > 1)\n");
+        return;
+    }
+    fprintf(stderr, "%" PRIu64 " frames at %.2f fps, %d/%d worker threads active at the end\n",
+            st.frames, st.time ? st.frames * 1e9 / st.time : 0.0,
+            st.active_threads, st.n_threads);
+    fprintf(stderr, "%.3f active core-seconds (%.2f ms per frame), "
+            "%.3f thread-seconds allowed to run\n",
+            st.busy_time / 1e9, st.frames ? st.busy_time / 1e6 / st.frames : 0.0,
+            st.active_time / 1e9);
+}
+
 static volatile sig_atomic_t signal_terminate;
 static void signal_handler(const int s) {
     signal_terminate = 1;
 }
 
+static int get_num_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetNativeSystemInfo(&system_info);
+    return system_info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    return 8;
+#endif
+}
+
+typedef struct DecodeOutput {
+    const CLISettings *cli_settings;
+    const char *name; // prefixed to error messages, or NULL
+    const char *muxer, *outputfile;
+    unsigned fps[2];
+    // called after each written picture, or NULL
+    void (*picture_written)(struct DecodeOutput *o);
+    void *cookie;
+    MuxerContext *out; // opened with the first picture
+    unsigned n_out;
+    int open_failed;
+} DecodeOutput;
+
+static void print_decode_error(const DecodeOutput *const o, const int res) {
+    if (o->name)
+        fprintf(stderr, "%s: Error decoding frame: %s\n",
+                o->name, strerror(DAV1D_ERR(res)));
+    else
+        fprintf(stderr, "Error decoding frame: %s\n",
+                strerror(DAV1D_ERR(res)));
+}
+
+static int write_picture(DecodeOutput *const o, Dav1dPicture *const p) {
+    int res;
+
+    if (!o->out && (res = output_open(&o->out, o->muxer, o->outputfile,
+                                      &p->p, o->fps)) < 0)
+    {
+        dav1d_picture_unref(p);
+        o->open_failed = 1;
+        return res;
+    }
+    if ((res = output_write(o->out, p)) < 0)
+        return res;
+    o->n_out++;
+    if (o->picture_written)
+        o->picture_written(o);
+    return 0;
+}
+
+// decodes the input, starting with the packet in *data, then drains the
+// decoder, up to the --limit number of pictures; used by both the single
+// input and the batch mode
+static int decode_input(Dav1dContext *const c, DemuxerContext *const in,
+                        Dav1dData *const data, DecodeOutput *const o)
+{
+    const CLISettings *const cli_settings = o->cli_settings;
+    Dav1dPicture p;
+    int res;
+
+    do {
+        if ((res = signal_terminate)) break;
+
+        memset(&p, 0, sizeof(p));
+        if ((res = dav1d_send_data(c, data)) < 0) {
+            if (res != DAV1D_ERR(EAGAIN)) {
+                dav1d_data_unref(data);
+                print_decode_error(o, res);
+                if (res != DAV1D_ERR(EINVAL)) break;
+            }
+        }
+
+        if ((res = dav1d_get_picture(c, &p)) < 0) {
+            if (res != DAV1D_ERR(EAGAIN)) {
+                print_decode_error(o, res);
+                if (res != DAV1D_ERR(EINVAL)) break;
+            }
+            res = 0;
+        } else if ((res = write_picture(o, &p)) < 0) {
+            break;
+        }
+
+        if (cli_settings->limit && o->n_out == cli_settings->limit)
+            break;
+    } while (data->sz > 0 || !input_read(in, data));
+
+    if (data->sz > 0) dav1d_data_unref(data);
+
+    // flush
+    if (res == 0) while (!cli_settings->limit || o->n_out < cli_settings->limit) {
+        if ((res = signal_terminate)) break;
+
+        if ((res = dav1d_get_picture(c, &p)) < 0) {
+            if (res != DAV1D_ERR(EAGAIN)) {
+                print_decode_error(o, res);
+                if (res != DAV1D_ERR(EINVAL)) break;
+            } else {
+                res = 0;
+                break;
+            }
+        } else if ((res = write_picture(o, &p)) < 0) {
+            break;
+        }
+    }
+
+    return res;
+}
+
+enum BatchResult {
+    BATCH_OK,
+    BATCH_ERROR,
+    BATCH_MISMATCH,
+};
+
+typedef struct {
+    char *input, *output, *verify;
+    unsigned frames;
+    uint64_t time;
+    enum BatchResult res;
+} BatchJob;
+
+typedef struct {
+    const CLISettings *cli_settings;
+    Dav1dSettings lib_settings;
+    BatchJob *jobs;
+    unsigned n_jobs, next_job;
+    pthread_mutex_t lock;
+} BatchContext;
+
+static char *copy_string(const char *const str) {
+    const size_t len = strlen(str) + 1;
+    char *const copy = malloc(len);
+    if (copy) memcpy(copy, str, len);
+    return copy;
+}
+
+static int batch_read_list(BatchContext *const b, const char *const filename) {
+    FILE *const f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    char line[4096];
+    unsigned n_alloc = 0;
+    int res = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char *fields[3] = { NULL }, *ptr = line;
+        int n_fields = 0;
+        while (n_fields < 3) {
+            ptr += strspn(ptr, " \t\r\n");
+            if (!*ptr || (!n_fields && *ptr == '#')) break;
+            fields[n_fields++] = ptr;
+            ptr += strcspn(ptr, " \t\r\n");
+            if (*ptr) *ptr++ = '\0';
+        }
+        if (!n_fields) continue;
+
+        if (b->n_jobs == n_alloc) {
+            n_alloc = n_alloc ? n_alloc * 2 : 16;
+            BatchJob *const jobs = realloc(b->jobs, n_alloc * sizeof(*jobs));
+            if (!jobs) {
+                fprintf(stderr, "Failed to allocate memory\n");
+                res = -1;
+                break;
+            }
+            b->jobs = jobs;
+        }
+        BatchJob *const job = &b->jobs[b->n_jobs++];
+        memset(job, 0, sizeof(*job));
+        job->input = copy_string(fields[0]);
+        if (fields[1] && strcmp(fields[1], "-"))
+            job->output = copy_string(fields[1]);
+        if (fields[2])
+            job->verify = copy_string(fields[2]);
+        if (!job->input || (fields[1] && strcmp(fields[1], "-") && !job->output) ||
+            (fields[2] && !job->verify))
+        {
+            fprintf(stderr, "Failed to allocate memory\n");
+            res = -1;
+            break;
+        }
+        if (job->output && job->verify) {
+            fprintf(stderr, "%s: a checksum requires the output to be '-'\n",
+                    job->input);
+            res = -1;
+            break;
+        }
+    }
+    fclose(f);
+
+    if (!res && !b->n_jobs) {
+        fprintf(stderr, "No inputs found in %s\n", filename);
+        res = -1;
+    }
+    return res;
+}
+
+static void batch_decode_job(const BatchContext *const b, BatchJob *const job) {
+    const CLISettings *const cli_settings = b->cli_settings;
+    DecodeOutput o = {
+        .cli_settings = cli_settings,
+        .name = job->input,
+        .muxer = cli_settings->muxer,
+        .outputfile = job->output,
+    };
+    DemuxerContext *in;
+    Dav1dContext *c;
+    Dav1dData data;
+    unsigned total, timebase[2];
+
+    // without an output file, only decode (or checksum) the pictures
+    if (job->verify) {
+        if (!o.muxer || (strcmp(o.muxer, "md5") && strcmp(o.muxer, "xxh3")))
+            o.muxer = "md5";
+        o.outputfile = "-";
+    } else if (!o.outputfile) {
+        o.muxer = "null";
+    }
+
+    job->res = BATCH_ERROR;
+    const uint64_t tstart = get_time_nanos();
+    if (input_open(&in, cli_settings->demuxer, job->input,
+                   o.fps, &total, timebase) < 0)
+    {
+        return;
+    }
+    if (input_read(in, &data) < 0) {
+        input_close(in);
+        return;
+    }
+    if (dav1d_open(&c, &b->lib_settings)) {
+        dav1d_data_unref(&data);
+        input_close(in);
+        return;
+    }
+
+    const int res = decode_input(c, in, &data, &o);
+    job->frames = o.n_out;
+
+    input_close(in);
+    dav1d_close(&c);
+    if (o.out) {
+        if (job->verify) {
+            if (output_verify(o.out, job->verify))
+                job->res = res ? BATCH_ERROR : BATCH_MISMATCH;
+            else if (!res)
+                job->res = BATCH_OK;
+        } else {
+            output_close(o.out);
+            if (!res)
+                job->res = BATCH_OK;
+        }
+    } else if (!o.open_failed) {
+        fprintf(stderr, "%s: No data decoded\n", job->input);
+    }
+    job->time = get_time_nanos() - tstart;
+}
+
+static void *batch_worker(void *const data) {
+    BatchContext *const b = data;
+
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        const unsigned n = b->next_job < b->n_jobs ? b->next_job++ : b->n_jobs;
+        pthread_mutex_unlock(&b->lock);
+        if (n == b->n_jobs) break;
+
+        batch_decode_job(b, &b->jobs[n]);
+    }
+    return NULL;
+}
+
+static void print_json_string(const char *const str) {
+    if (!str) {
+        printf("null");
+        return;
+    }
+    putchar('"');
+    for (const unsigned char *ptr = (const unsigned char *) str; *ptr; ptr++) {
+        if (*ptr == '"' || *ptr == '\\')
+            printf("\\%c", *ptr);
+        else if (*ptr < 0x20)
+            printf("\\u%04x", *ptr);
+        else
+            putchar(*ptr);
+    }
+    putchar('"');
+}
+
+static void batch_print_stats(const BatchContext *const b, const unsigned n_jobs,
+                              const uint64_t elapsed)
+{
+    static const char *const result_names[] = {
+        [BATCH_OK]       = "ok",
+        [BATCH_ERROR]    = "error",
+        [BATCH_MISMATCH] = "mismatch",
+    };
+    uint64_t frames = 0;
+    unsigned failed = 0;
+
+    printf("{\n  \"jobs\": %u,\n  \"threads_per_job\": %d,\n  \"files\": [\n",
+           n_jobs, b->lib_settings.n_threads);
+    for (unsigned n = 0; n < b->n_jobs; n++) {
+        const BatchJob *const job = &b->jobs[n];
+        printf("    { \"input\": ");
+        print_json_string(job->input);
+        printf(", \"output\": ");
+        print_json_string(job->output);
+        printf(", \"frames\": %u, \"time\": %.6f, \"fps\": %.2f, \"result\": \"%s\" }%s\n",
+               job->frames, job->time / 1e9,
+               job->time ? job->frames * 1e9 / job->time : 0.0,
+               result_names[job->res], n + 1 < b->n_jobs ? "," : "");
+        frames += job->frames;
+        failed += job->res != BATCH_OK;
+    }
+    printf("  ],\n  \"frames\": %" PRIu64 ",\n  \"time\": %.6f,\n"
+           "  \"fps\": %.2f,\n  \"failed\": %u\n}\n",
+           frames, elapsed / 1e9, elapsed ? frames * 1e9 / elapsed : 0.0, failed);
+}
+
+// decodes all inputs of the --batch list, up to --jobs of them at a time,
+// each one with its own decoder and an even share of the worker threads
+static int batch_decode(const CLISettings *const cli_settings,
+                        const Dav1dSettings *const lib_settings)
+{
+    BatchContext b = {
+        .cli_settings = cli_settings,
+        .lib_settings = *lib_settings,
+    };
+    pthread_t threads[256];
+    unsigned n_threads = 0;
+    int res = -1;
+
+    if (pthread_mutex_init(&b.lock, NULL))
+        return EXIT_FAILURE;
+    if (batch_read_list(&b, cli_settings->batch))
+        goto end;
+
+    unsigned n_jobs = cli_settings->jobs;
+    if (n_jobs > b.n_jobs) n_jobs = b.n_jobs;
+    if (n_jobs > sizeof(threads) / sizeof(*threads))
+        n_jobs = sizeof(threads) / sizeof(*threads);
+    const int total_threads = lib_settings->n_threads ? lib_settings->n_threads
+                                                      : get_num_cpus();
+    b.lib_settings.n_threads = total_threads / (int) n_jobs;
+    if (b.lib_settings.n_threads < 1) b.lib_settings.n_threads = 1;
+
+    if (!cli_settings->quiet)
+        fprintf(stderr, "dav1d %s - by VideoLAN\n"
+                "decoding %u inputs, %u at a time with %d threads each\n",
+                dav1d_version(), b.n_jobs, n_jobs, b.lib_settings.n_threads);
+
+    const uint64_t tstart = get_time_nanos();
+    while (n_threads < n_jobs) {
+        if (pthread_create(&threads[n_threads], NULL, batch_worker, &b))
+            break;
+        n_threads++;
+    }
+    // if not all threads could be created, the others still process every job
+    if (!n_threads) batch_worker(&b);
+    for (unsigned n = 0; n < n_threads; n++)
+        pthread_join(threads[n], NULL);
+
+    batch_print_stats(&b, n_threads ? n_threads : 1, get_time_nanos() - tstart);
+    res = 0;
+    for (unsigned n = 0; n < b.n_jobs; n++)
+        res |= b.jobs[n].res != BATCH_OK;
+
+end:
+    for (unsigned n = 0; n < b.n_jobs; n++) {
+        free(b.jobs[n].input);
+        free(b.jobs[n].output);
+        free(b.jobs[n].verify);
+    }
+    free(b.jobs);
+    pthread_mutex_destroy(&b.lock);
+
+    return (res == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+typedef struct {
+    const CLISettings *cli_settings;
+    int istty;
+    unsigned total;
+    uint64_t nspf, tfirst, elapsed;
+    double i_fps;
+    FILE *frametimes;
+} Progress;
+
+static void report_progress(DecodeOutput *const o) {
+    Progress *const pr = o->cookie;
+    const CLISettings *const cli_settings = pr->cli_settings;
+
+    if (pr->nspf || !cli_settings->quiet) {
+        synchronize(cli_settings->realtime, cli_settings->realtime_cache,
+                    o->n_out, pr->nspf, pr->tfirst, &pr->elapsed, pr->frametimes);
+    }
+    if (!cli_settings->quiet)
+        print_stats(pr->istty, o->n_out, pr->total, pr->elapsed, pr->i_fps);
+}
+
 int main(const int argc, char *const *const argv) {
-    const int istty = isatty(fileno(stderr));
     int res = 0;
     CLISettings cli_settings;
     Dav1dSettings lib_settings;
     DemuxerContext *in;
-    MuxerContext *out = NULL;
-    Dav1dPicture p;
     Dav1dContext *c;
     Dav1dData data;
-    unsigned n_out = 0, total, fps[2], timebase[2];
-    uint64_t nspf, tfirst, elapsed;
-    double i_fps;
-    FILE *frametimes = NULL;
+    unsigned timebase[2];
+    Progress pr = {
+        .cli_settings = &cli_settings,
+        .istty = isatty(fileno(stderr)),
+    };
+    DecodeOutput o = {
+        .cli_settings = &cli_settings,
+        .picture_written = report_progress,
+        .cookie = &pr,
+    };
     const unsigned version = dav1d_version_api();
     const int major = DAV1D_API_MAJOR(version);
     const int minor = DAV1D_API_MINOR(version);
@@ -221,10 +702,14 @@ int main(const int argc, char *const *const argv) {
         lib_settings.allocator.alloc_picture_callback = picture_alloc;
         lib_settings.allocator.release_picture_callback = picture_release;
     }
+    if (cli_settings.batch)
+        return batch_decode(&cli_settings, &lib_settings);
 
+    o.muxer = cli_settings.muxer;
+    o.outputfile = cli_settings.outputfile;
     if ((res = input_open(&in, cli_settings.demuxer,
                           cli_settings.inputfile,
-                          fps, &total, timebase)) < 0)
+                          o.fps, &pr.total, timebase)) < 0)
     {
         return EXIT_FAILURE;
     }
@@ -256,28 +741,40 @@ int main(const int argc, char *const *const argv) {
                     seq_skip);
     }
 
-    if (cli_settings.limit != 0 && cli_settings.limit < total)
-        total = cli_settings.limit;
+    if (cli_settings.limit != 0 && cli_settings.limit < pr.total)
+        pr.total = cli_settings.limit;
+
+    if (lib_settings.energy_saving) {
+        // the framerate to keep up with; without one, the library uses
+        // the one signaled in the sequence header, if any
+        if (cli_settings.realtime == REALTIME_CUSTOM) {
+            lib_settings.target_fps_num = (unsigned) (cli_settings.realtime_fps * 1000 + 0.5);
+            lib_settings.target_fps_den = 1000;
+        } else if (o.fps[0] && o.fps[1]) {
+            lib_settings.target_fps_num = o.fps[0];
+            lib_settings.target_fps_den = o.fps[1];
+        }
+    }
 
     if ((res = dav1d_open(&c, &lib_settings)))
         return EXIT_FAILURE;
 
     if (cli_settings.frametimes)
-        frametimes = fopen(cli_settings.frametimes, "w");
+        pr.frametimes = fopen(cli_settings.frametimes, "w");
 
     if (cli_settings.realtime != REALTIME_CUSTOM) {
-        if (fps[1] == 0) {
-            i_fps = 0;
-            nspf = 0;
+        if (o.fps[1] == 0) {
+            pr.i_fps = 0;
+            pr.nspf = 0;
         } else {
-            i_fps = (double)fps[0] / fps[1];
-            nspf = 1000000000ULL * fps[1] / fps[0];
+            pr.i_fps = (double)o.fps[0] / o.fps[1];
+            pr.nspf = 1000000000ULL * o.fps[1] / o.fps[0];
         }
     } else {
-        i_fps = cli_settings.realtime_fps;
-        nspf = (uint64_t)(1000000000.0 / cli_settings.realtime_fps);
+        pr.i_fps = cli_settings.realtime_fps;
+        pr.nspf = (uint64_t)(1000000000.0 / cli_settings.realtime_fps);
     }
-    tfirst = get_time_nanos();
+    pr.tfirst = get_time_nanos();
 
 #ifdef _WIN32
     signal(SIGINT,  signal_handler);
@@ -291,102 +788,29 @@ int main(const int argc, char *const *const argv) {
     sigaction(SIGTERM, &sa, NULL);
 #endif
 
-    do {
-        if ((res = signal_terminate)) break;
-
-        memset(&p, 0, sizeof(p));
-        if ((res = dav1d_send_data(c, &data)) < 0) {
-            if (res != DAV1D_ERR(EAGAIN)) {
-                dav1d_data_unref(&data);
-                fprintf(stderr, "Error decoding frame: %s\n",
-                        strerror(DAV1D_ERR(res)));
-                if (res != DAV1D_ERR(EINVAL)) break;
-            }
-        }
-
-        if ((res = dav1d_get_picture(c, &p)) < 0) {
-            if (res != DAV1D_ERR(EAGAIN)) {
-                fprintf(stderr, "Error decoding frame: %s\n",
-                        strerror(DAV1D_ERR(res)));
-                if (res != DAV1D_ERR(EINVAL)) break;
-            }
-            res = 0;
-        } else {
-            if (!n_out) {
-                if ((res = output_open(&out, cli_settings.muxer,
-                                       cli_settings.outputfile,
-                                       &p.p, fps)) < 0)
-                {
-                    if (frametimes) fclose(frametimes);
-                    return EXIT_FAILURE;
-                }
-            }
-            if ((res = output_write(out, &p)) < 0)
-                break;
-            n_out++;
-            if (nspf || !cli_settings.quiet) {
-                synchronize(cli_settings.realtime, cli_settings.realtime_cache,
-                            n_out, nspf, tfirst, &elapsed, frametimes);
-            }
-            if (!cli_settings.quiet)
-                print_stats(istty, n_out, total, elapsed, i_fps);
-        }
-
-        if (cli_settings.limit && n_out == cli_settings.limit)
-            break;
-    } while (data.sz > 0 || !input_read(in, &data));
-
-    if (data.sz > 0) dav1d_data_unref(&data);
-
-    // flush
-    if (res == 0) while (!cli_settings.limit || n_out < cli_settings.limit) {
-        if ((res = signal_terminate)) break;
-
-        if ((res = dav1d_get_picture(c, &p)) < 0) {
-            if (res != DAV1D_ERR(EAGAIN)) {
-                fprintf(stderr, "Error decoding frame: %s\n",
-                        strerror(DAV1D_ERR(res)));
-                if (res != DAV1D_ERR(EINVAL)) break;
-            } else {
-                res = 0;
-                break;
-            }
-        } else {
-            if (!n_out) {
-                if ((res = output_open(&out, cli_settings.muxer,
-                                       cli_settings.outputfile,
-                                       &p.p, fps)) < 0)
-                {
-                    if (frametimes) fclose(frametimes);
-                    return EXIT_FAILURE;
-                }
-            }
-            if ((res = output_write(out, &p)) < 0)
-                break;
-            n_out++;
-            if (nspf || !cli_settings.quiet) {
-                synchronize(cli_settings.realtime, cli_settings.realtime_cache,
-                            n_out, nspf, tfirst, &elapsed, frametimes);
-            }
-            if (!cli_settings.quiet)
-                print_stats(istty, n_out, total, elapsed, i_fps);
-        }
-    }
+    res = decode_input(c, in, &data, &o);
 
-    if (frametimes) fclose(frametimes);
+    if (pr.frametimes) fclose(pr.frametimes);
 
     input_close(in);
-    if (out) {
-        if (!cli_settings.quiet && istty)
+    if (o.out) {
+        if (!cli_settings.quiet && pr.istty)
             fprintf(stderr, "\n");
         if (cli_settings.verify)
-            res |= output_verify(out, cli_settings.verify);
+            res |= output_verify(o.out, cli_settings.verify);
         else
-            output_close(out);
+            output_close(o.out);
     } else {
-        fprintf(stderr, "No data decoded\n");
+        if (!o.open_failed)
+            fprintf(stderr, "No data decoded\n");
         res = 1;
     }
+    if (lib_settings.perf_counters)
+        print_perf_counters(c);
+    if (lib_settings.stall_stats)
+        print_stall_stats(c);
+    if (lib_settings.energy_saving)
+        print_energy_stats(c);
     dav1d_close(&c);
 
     return (res == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
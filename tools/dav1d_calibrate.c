@@ -0,0 +1,395 @@
+/*
+ * Copyright © 2024, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Sweeps n_threads and max_frame_delay on a sample stream, decoding from
+ * memory without output, and prints the Pareto-optimal configurations in
+ * terms of threads, throughput and worst-case frame latency as JSON, along
+ * with the cheapest configuration that meets the given target.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef _WIN32
+# include <windows.h>
+#endif
+
+#include "dav1d/dav1d.h"
+
+#include "input/input.h"
+
+#include "dav1d_time.h"
+
+// the library's automatic frame delay never exceeds this either
+#define MAX_SWEEP_FRAME_DELAY 8
+
+typedef struct {
+    uint8_t *buf;
+    size_t sz;
+} Packet;
+
+typedef struct {
+    int n_threads, max_frame_delay;
+    double fps;
+    double max_latency, mean_latency; // in milliseconds
+    int pareto;
+} Result;
+
+static int get_num_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetNativeSystemInfo(&system_info);
+    return system_info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    return 8;
+#endif
+}
+
+static void free_nothing(const uint8_t *const data, void *const cookie) {
+}
+
+static int read_packets(const char *const filename, Packet **const out,
+                        int *const n_out)
+{
+    DemuxerContext *in;
+    unsigned fps[2], total, timebase[2];
+    if (input_open(&in, NULL, filename, fps, &total, timebase) < 0)
+        return -1;
+
+    Packet *packets = NULL;
+    int n = 0, res = 0;
+    Dav1dData data;
+    if (!input_read(in, &data)) do {
+        Packet *const p = realloc(packets, (n + 1) * sizeof(*p));
+        if (!p) {
+            dav1d_data_unref(&data);
+            res = -1;
+            break;
+        }
+        packets = p;
+        uint8_t *const buf = malloc(data.sz);
+        if (!buf) {
+            dav1d_data_unref(&data);
+            res = -1;
+            break;
+        }
+        memcpy(buf, data.data, data.sz);
+        packets[n].buf = buf;
+        packets[n++].sz = data.sz;
+        dav1d_data_unref(&data);
+    } while (!input_read(in, &data) && data.sz > 0);
+    input_close(in);
+
+    if (res < 0 || !n) {
+        for (int i = 0; i < n; i++) free(packets[i].buf);
+        free(packets);
+        return -1;
+    }
+    *out = packets;
+    *n_out = n;
+    return 0;
+}
+
+// the packet index is passed through as timestamp to measure the latency
+static int receive(Dav1dContext *const c, const uint64_t *const send_time,
+                   const int n_packets, Result *const r, int *const n_out)
+{
+    Dav1dPicture p;
+    memset(&p, 0, sizeof(p));
+    const int res = dav1d_get_picture(c, &p);
+    if (res < 0) return res;
+
+    const int64_t idx = p.m.timestamp;
+    const double latency = idx < 0 || idx >= n_packets ? 0.0 :
+        (get_time_nanos() - send_time[idx]) / 1000000.0;
+    if (latency > r->max_latency) r->max_latency = latency;
+    r->mean_latency += latency;
+    (*n_out)++;
+    dav1d_picture_unref(&p);
+    return 0;
+}
+
+// decode all packets with the given settings, returns the number of pictures
+static int run(const Packet *const packets, const int n_packets,
+               uint64_t *const send_time, const int n_threads,
+               const int max_frame_delay, Result *const r)
+{
+    Dav1dSettings s;
+    dav1d_default_settings(&s);
+    s.n_threads = n_threads;
+    s.max_frame_delay = max_frame_delay;
+    s.logger.callback = NULL;
+
+    Dav1dContext *c;
+    if (dav1d_open(&c, &s) < 0) return -1;
+
+    memset(r, 0, sizeof(*r));
+    int n_out = 0, res = 0;
+    const uint64_t start = get_time_nanos();
+    for (int i = 0; i < n_packets && !res; i++) {
+        Dav1dData data;
+        if (dav1d_data_wrap(&data, packets[i].buf, packets[i].sz,
+                            free_nothing, NULL) < 0)
+        {
+            res = -1;
+            break;
+        }
+        data.m.timestamp = i;
+        send_time[i] = get_time_nanos();
+        do {
+            res = dav1d_send_data(c, &data);
+            if (res < 0 && res != DAV1D_ERR(EAGAIN)) break;
+            res = receive(c, send_time, n_packets, r, &n_out);
+            if (res == DAV1D_ERR(EAGAIN)) res = 0;
+        } while (!res && data.sz);
+        if (data.sz) dav1d_data_unref(&data);
+        // like the CLI, carry on after bitstream errors
+        if (res == DAV1D_ERR(EINVAL)) res = 0;
+    }
+    // drain
+    while (!res || res == DAV1D_ERR(EINVAL))
+        res = receive(c, send_time, n_packets, r, &n_out);
+    const uint64_t elapsed = get_time_nanos() - start;
+    dav1d_close(&c);
+
+    if (res != DAV1D_ERR(EAGAIN)) {
+        fprintf(stderr, "Decoding error: %s\n", strerror(DAV1D_ERR(res)));
+        return -1;
+    }
+    r->n_threads = n_threads;
+    r->max_frame_delay = max_frame_delay;
+    r->fps = elapsed ? n_out * 1000000000.0 / elapsed : 0.0;
+    if (n_out) r->mean_latency /= n_out;
+    return n_out;
+}
+
+// a is at least as good as b in every dimension, and better in one
+static int dominates(const Result *const a, const Result *const b) {
+    if (a->n_threads > b->n_threads || a->fps < b->fps ||
+        a->max_latency > b->max_latency)
+    {
+        return 0;
+    }
+    return a->n_threads < b->n_threads || a->fps > b->fps ||
+           a->max_latency < b->max_latency;
+}
+
+static int meets_target(const Result *const r, const double max_latency,
+                        const double min_fps)
+{
+    return (!max_latency || r->max_latency <= max_latency) &&
+           (!min_fps || r->fps >= min_fps);
+}
+
+static void print_result(FILE *const f, const Result *const r) {
+    fprintf(f, "{ \"n_threads\": %d, \"max_frame_delay\": %d, \"fps\": %.2f, "
+            "\"max_latency_ms\": %.3f, \"mean_latency_ms\": %.3f }",
+            r->n_threads, r->max_frame_delay, r->fps, r->max_latency,
+            r->mean_latency);
+}
+
+static void usage(const char *const app, const char *const reason) {
+    if (reason) fprintf(stderr, "%s\n\n", reason);
+    fprintf(stderr, "Usage: %s [options]\n\n", app);
+    fprintf(stderr, "Supported options:\n"
+            " --input/-i $file:     sample input stream\n"
+            " --output/-o $file:    output JSON file (default: stdout)\n"
+            " --maxlatency $ms:     target worst-case frame latency in milliseconds\n"
+            " --minfps $num:        target decoding speed in frames per second\n"
+            " --maxthreads $num:    largest thread count to try (default: number of cores)\n"
+            " --runs $num:          decode runs per configuration, the best is kept (default: 2)\n");
+    exit(1);
+}
+
+static double parse_positive(const char *const arg, const char *const app,
+                             const char *const what)
+{
+    char *end;
+    const double v = strtod(arg, &end);
+    if (*end || end == arg || v <= 0) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Invalid %s: %s", what, arg);
+        usage(app, msg);
+    }
+    return v;
+}
+
+enum {
+    ARG_MAX_LATENCY = 256,
+    ARG_MIN_FPS,
+    ARG_MAX_THREADS,
+    ARG_RUNS,
+};
+
+int main(const int argc, char *const *const argv) {
+    static const struct option long_opts[] = {
+        { "input",      1, NULL, 'i' },
+        { "output",     1, NULL, 'o' },
+        { "maxlatency", 1, NULL, ARG_MAX_LATENCY },
+        { "minfps",     1, NULL, ARG_MIN_FPS },
+        { "maxthreads", 1, NULL, ARG_MAX_THREADS },
+        { "runs",       1, NULL, ARG_RUNS },
+        { NULL,         0, NULL, 0 },
+    };
+    const char *input = NULL, *output = NULL;
+    double max_latency = 0, min_fps = 0;
+    int max_threads = 0, runs = 2, o;
+
+    while ((o = getopt_long(argc, argv, "i:o:", long_opts, NULL)) != -1) {
+        switch (o) {
+        case 'i': input = optarg; break;
+        case 'o': output = optarg; break;
+        case ARG_MAX_LATENCY:
+            max_latency = parse_positive(optarg, argv[0], "latency");
+            break;
+        case ARG_MIN_FPS:
+            min_fps = parse_positive(optarg, argv[0], "frame rate");
+            break;
+        case ARG_MAX_THREADS:
+            max_threads = (int) parse_positive(optarg, argv[0], "thread count");
+            break;
+        case ARG_RUNS:
+            runs = (int) parse_positive(optarg, argv[0], "run count");
+            break;
+        default: usage(argv[0], NULL);
+        }
+    }
+    if (!input) usage(argv[0], "Input file required");
+    if (!max_latency && !min_fps) usage(argv[0], "A latency or frame rate target is required");
+    if (!max_threads) max_threads = get_num_cpus();
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > DAV1D_MAX_THREADS) max_threads = DAV1D_MAX_THREADS;
+
+    Packet *packets;
+    int n_packets;
+    if (read_packets(input, &packets, &n_packets) < 0) {
+        fprintf(stderr, "Failed to read %s\n", input);
+        return EXIT_FAILURE;
+    }
+    uint64_t *const send_time = malloc(n_packets * sizeof(*send_time));
+    Result *results = NULL;
+    int n_results = 0, n_out = 0, res = EXIT_SUCCESS;
+    if (!send_time) {
+        res = EXIT_FAILURE;
+        goto end;
+    }
+
+    // thread counts grow by ~1.5x up to max_threads, which is always tried
+    for (int n_threads = 1;; n_threads = n_threads < 4 ? n_threads + 1 : n_threads * 3 / 2) {
+        if (n_threads > max_threads) n_threads = max_threads;
+        const int max_delay =
+            n_threads < MAX_SWEEP_FRAME_DELAY ? n_threads : MAX_SWEEP_FRAME_DELAY;
+        for (int delay = 1; delay <= max_delay; delay++) {
+            Result best = { 0 };
+            for (int i = 0; i < runs; i++) {
+                Result r;
+                if ((n_out = run(packets, n_packets, send_time, n_threads, delay, &r)) < 0) {
+                    res = EXIT_FAILURE;
+                    goto end;
+                }
+                if (!i || r.fps > best.fps) best = r;
+            }
+            Result *const tmp = realloc(results, (n_results + 1) * sizeof(*tmp));
+            if (!tmp) {
+                res = EXIT_FAILURE;
+                goto end;
+            }
+            results = tmp;
+            results[n_results++] = best;
+            fprintf(stderr, "threads %d, frame delay %d: %.2f fps, %.3f ms max latency\n",
+                    n_threads, delay, best.fps, best.max_latency);
+        }
+        if (n_threads == max_threads) break;
+    }
+
+    const Result *recommended = NULL;
+    for (int i = 0; i < n_results; i++) {
+        results[i].pareto = 1;
+        for (int j = 0; j < n_results; j++)
+            if (dominates(&results[j], &results[i])) {
+                results[i].pareto = 0;
+                break;
+            }
+        if (!results[i].pareto || !meets_target(&results[i], max_latency, min_fps))
+            continue;
+        // fewest threads, then the most headroom for the target
+        if (!recommended || results[i].n_threads < recommended->n_threads ||
+            (results[i].n_threads == recommended->n_threads &&
+             (max_latency ? results[i].max_latency < recommended->max_latency :
+                            results[i].fps > recommended->fps)))
+        {
+            recommended = &results[i];
+        }
+    }
+
+    FILE *const f = output ? fopen(output, "w") : stdout;
+    if (!f) {
+        fprintf(stderr, "Failed to open %s: %s\n", output, strerror(errno));
+        res = EXIT_FAILURE;
+        goto end;
+    }
+    fprintf(f, "{\n  \"dav1d_version\": \"%s\",\n  \"frames\": %d,\n", dav1d_version(), n_out);
+    fprintf(f, "  \"target\": {");
+    if (max_latency) fprintf(f, " \"max_latency_ms\": %.3f%s", max_latency, min_fps ? "," : "");
+    if (min_fps) fprintf(f, " \"min_fps\": %.2f", min_fps);
+    fprintf(f, " },\n  \"recommended\": ");
+    if (recommended)
+        print_result(f, recommended);
+    else
+        fprintf(f, "null");
+    fprintf(f, ",\n  \"pareto\": [");
+    for (int i = 0, first = 1; i < n_results; i++) {
+        if (!results[i].pareto) continue;
+        fprintf(f, "%s\n    ", first ? "" : ",");
+        print_result(f, &results[i]);
+        first = 0;
+    }
+    fprintf(f, "\n  ]\n}\n");
+    if (output) fclose(f);
+    if (!recommended) {
+        fprintf(stderr, "No configuration meets the target\n");
+        res = EXIT_FAILURE;
+    }
+
+end:
+    for (int i = 0; i < n_packets; i++) free(packets[i].buf);
+    free(packets);
+    free(send_time);
+    free(results);
+    return res;
+}
@@ -63,6 +63,17 @@ enum {
     ARG_OUTPUT_INVISIBLE,
     ARG_INLOOP_FILTERS,
     ARG_DECODE_FRAME_TYPE,
+    ARG_PERF_COUNTERS,
+    ARG_STALL_STATS,
+    ARG_RESYNC,
+    ARG_BLOCK_LIMIT,
+    ARG_THREAD_AFFINITY,
+    ARG_ENERGY_SAVING,
+    ARG_PARALLEL_GOPS,
+    ARG_LUMA_ONLY,
+    ARG_ENTROPY_ONLY,
+    ARG_BATCH,
+    ARG_JOBS,
 };
 
 static const struct option long_opts[] = {
@@ -90,6 +101,17 @@ static const struct option long_opts[] = {
     { "outputinvisible", 1, NULL, ARG_OUTPUT_INVISIBLE },
     { "inloopfilters",   1, NULL, ARG_INLOOP_FILTERS },
     { "decodeframetype", 1, NULL, ARG_DECODE_FRAME_TYPE },
+    { "perfcounters",    0, NULL, ARG_PERF_COUNTERS },
+    { "stallstats",      0, NULL, ARG_STALL_STATS },
+    { "resync",          1, NULL, ARG_RESYNC },
+    { "blocklimit",      1, NULL, ARG_BLOCK_LIMIT },
+    { "affinity",        1, NULL, ARG_THREAD_AFFINITY },
+    { "energysaving",    0, NULL, ARG_ENERGY_SAVING },
+    { "parallelgops",    1, NULL, ARG_PARALLEL_GOPS },
+    { "lumaonly",        0, NULL, ARG_LUMA_ONLY },
+    { "entropyonly",     0, NULL, ARG_ENTROPY_ONLY },
+    { "batch",           1, NULL, ARG_BATCH },
+    { "jobs",            1, NULL, ARG_JOBS },
     { NULL,              0, NULL, 0 },
 };
 
@@ -153,6 +175,18 @@ static void usage(const char *const app, const char *const reason, ...) {
             " --outputinvisible $num: whether to output invisible (alt-ref) frames (default: 0)\n"
             " --inloopfilters $str: which in-loop filters to enable (none, (no)deblock, (no)cdef, (no)restoration or all; default: all)\n"
             " --decodeframetype $str: which frame types to decode (reference, intra, key or all; default: all)\n"
+            " --perfcounters:       print hardware performance counters per decoding task type (Linux only)\n"
+            " --stallstats:         print why worker threads were idle, and the critical path\n"
+            " --resync $num:        silently skip frames with missing references until a random access point (default: 0)\n"
+            " --blocklimit $num:    abort decoding of frames with more than $num blocks (default: 0 = unlimited)\n"
+            " --affinity $str:      placement of worker threads (none, or l3 to confine them to one L3 cache domain; default: none)\n"
+            " --energysaving:       only keep as many worker threads running as needed for the --realtime or input framerate\n"
+            " --parallelgops $num:  decode $num closed GOPs concurrently, splitting the threads between them (offline use; default: 0)\n"
+            " --lumaonly:           only reconstruct and output the luma plane (grayscale)\n"
+            " --entropyonly:        only parse the frames, without reconstructing them; implies --muxer null\n"
+            " --batch $file:        decode all inputs listed in $file, one '$input [$output|- [$checksum]]' per line,\n"
+            "                       and print per-file and aggregate statistics as JSON\n"
+            " --jobs $num:          number of --batch inputs decoded concurrently, sharing the --threads (default: 1)\n"
             );
     exit(1);
 }
@@ -282,6 +316,11 @@ static const EnumParseTable decode_frame_type_tbl[] = {
     { "key",           DAV1D_DECODEFRAMETYPE_KEY },
 };
 
+static const EnumParseTable thread_affinity_tbl[] = {
+    { "none",          DAV1D_THREAD_AFFINITY_NONE },
+    { "l3",            DAV1D_THREAD_AFFINITY_L3 },
+};
+
 #define ARRAY_SIZE(n) (sizeof(n)/sizeof(*(n)))
 
 static unsigned parse_enum(char *optarg, const EnumParseTable *const tbl,
@@ -327,6 +366,7 @@ void parse(const int argc, char *const *const argv,
     memset(cli_settings, 0, sizeof(*cli_settings));
     dav1d_default_settings(lib_settings);
     lib_settings->strict_std_compliance = 1; // override library default
+    cli_settings->jobs = 1;
     int grain_specified = 0;
 
     while ((o = getopt_long(argc, argv, short_opts, long_opts, NULL)) != -1) {
@@ -419,6 +459,47 @@ void parse(const int argc, char *const *const argv,
         case ARG_NEG_STRIDE:
             cli_settings->neg_stride = 1;
             break;
+        case ARG_PERF_COUNTERS:
+            lib_settings->perf_counters = 1;
+            break;
+        case ARG_STALL_STATS:
+            lib_settings->stall_stats = 1;
+            break;
+        case ARG_RESYNC:
+            lib_settings->resync =
+                !!parse_unsigned(optarg, ARG_RESYNC, argv[0]);
+            break;
+        case ARG_BLOCK_LIMIT:
+            lib_settings->frame_block_limit =
+                parse_unsigned(optarg, ARG_BLOCK_LIMIT, argv[0]);
+            break;
+        case ARG_THREAD_AFFINITY:
+            lib_settings->thread_affinity =
+                parse_enum(optarg, thread_affinity_tbl,
+                           ARRAY_SIZE(thread_affinity_tbl), ARG_THREAD_AFFINITY, argv[0]);
+            break;
+        case ARG_ENERGY_SAVING:
+            lib_settings->energy_saving = 1;
+            break;
+        case ARG_PARALLEL_GOPS:
+            lib_settings->parallel_gops =
+                parse_unsigned(optarg, ARG_PARALLEL_GOPS, argv[0]);
+            break;
+        case ARG_LUMA_ONLY:
+            lib_settings->luma_only = 1;
+            break;
+        case ARG_ENTROPY_ONLY:
+            lib_settings->entropy_only = 1;
+            break;
+        case ARG_BATCH:
+            cli_settings->batch = optarg;
+            break;
+        case ARG_JOBS:
+            cli_settings->jobs =
+                parse_unsigned(optarg, ARG_JOBS, argv[0]);
+            if (!cli_settings->jobs)
+                error(argv[0], optarg, ARG_JOBS, "an integer greater than 0");
+            break;
         case ARG_OUTPUT_INVISIBLE:
             lib_settings->output_invisible_frames =
                 !!parse_unsigned(optarg, ARG_OUTPUT_INVISIBLE, argv[0]);
@@ -441,6 +522,8 @@ void parse(const int argc, char *const *const argv,
     if (optind < argc)
         usage(argv[0], "Extra/unused arguments found, e.g. '%s'\n", argv[optind]);
     if (cli_settings->verify) {
+        if (cli_settings->batch)
+            usage(argv[0], "Batch mode (--batch) takes the checksums from the list");
         if (cli_settings->outputfile)
             usage(argv[0], "Verification (--verify) requires output file (-o/--output) to not set");
         if (cli_settings->muxer && strcmp(cli_settings->muxer, "md5") &&
@@ -454,6 +537,14 @@ void parse(const int argc, char *const *const argv,
             cli_settings->muxer = "md5";
     }
 
+    if (lib_settings->entropy_only) {
+        if (cli_settings->verify || cli_settings->batch)
+            usage(argv[0], "Parsing only (--entropyonly) cannot be combined with --verify or --batch");
+        if (cli_settings->muxer && strcmp(cli_settings->muxer, "null"))
+            usage(argv[0], "Parsing only (--entropyonly) requires the null muxer");
+        cli_settings->muxer = "null";
+    }
+
     if (!grain_specified && cli_settings->muxer &&
         (!strcmp(cli_settings->muxer, "md5") ||
         !strcmp(cli_settings->muxer, "xxh3")))
@@ -461,6 +552,11 @@ void parse(const int argc, char *const *const argv,
         lib_settings->apply_grain = 0;
     }
 
+    if (cli_settings->batch) {
+        if (cli_settings->inputfile || cli_settings->outputfile)
+            usage(argv[0], "Batch mode (--batch) takes the input and output files from the list");
+        return;
+    }
     if (!cli_settings->inputfile)
         usage(argv[0], "Input file (-i/--input) is required");
     if ((!cli_settings->muxer || strcmp(cli_settings->muxer, "null")) &&
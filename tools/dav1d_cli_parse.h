@@ -47,6 +47,8 @@ typedef struct {
     double realtime_fps;
     unsigned realtime_cache;
     int neg_stride;
+    const char *batch;
+    unsigned jobs;
 } CLISettings;
 
 void parse(const int argc, char *const *const argv,